@@ -0,0 +1,159 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <variant>
+
+#include <sys/types.h>
+
+#include "json.hpp"
+#include "parser.hpp"
+
+namespace sjp {
+// Lazily started coroutine producing a T. Awaiting it from another
+// coroutine starts it and resumes the awaiter when it finishes.
+template <typename T> class Task {
+  public:
+    struct promise_type {
+        std::variant<std::monostate, T, std::exception_ptr> result;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                auto next = handle.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T value) {
+            result.template emplace<1>(std::move(value));
+        }
+        void unhandled_exception() {
+            result.template emplace<2>(std::current_exception());
+        }
+    };
+
+    Task(Task &&other) noexcept
+        : handle(std::exchange(other.handle, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return Result(); }
+
+    // Runs the task up to its first suspension, see EventLoop::Spawn.
+    void Start() { handle.resume(); }
+
+    bool Done() const { return handle.done(); }
+
+    // Rethrows the exception the task finished with.
+    T Result() {
+        auto &result = handle.promise().result;
+        if (auto *error = std::get_if<std::exception_ptr>(&result)) {
+            std::rethrow_exception(*error);
+        }
+        return std::move(std::get<T>(result));
+    }
+
+  private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Single-threaded completion loop for coroutine reads. io_uring is used
+// when the kernel allows it, epoll otherwise. With epoll, regular files
+// are read directly since they are always ready.
+class EventLoop {
+  public:
+    enum class Backend { automatic, io_uring, epoll };
+
+    // Throws if the requested backend is not available.
+    explicit EventLoop(Backend backend = Backend::automatic);
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    Backend Kind() const { return ring ? Backend::io_uring : Backend::epoll; }
+
+    // co_await loop.Read(fd, buf, len) suspends until data is available and
+    // yields the bytes read, 0 at end of file or -errno.
+    struct ReadOp {
+        EventLoop &loop;
+        int fd;
+        char *buf;
+        size_t len;
+        ssize_t result = 0;
+        std::coroutine_handle<> waiter{};
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            waiter = handle;
+            return loop.Submit(*this);
+        }
+        ssize_t await_resume() const noexcept { return result; }
+    };
+
+    ReadOp Read(int fd, char *buf, size_t len) {
+        return {.loop = *this, .fd = fd, .buf = buf, .len = len};
+    }
+
+    // Drops any registration kept for fd, call before closing it.
+    void Forget(int fd);
+
+    template <typename T> void Spawn(Task<T> &task) { task.Start(); }
+
+    // Resumes suspended reads as they complete until none is left, so all
+    // spawned tasks have finished when it returns.
+    void Run();
+
+  private:
+    struct Ring;
+
+    std::unique_ptr<Ring> ring;
+    int epoll_fd = -1;
+    size_t pending = 0;
+
+    // false if the read already completed and the caller goes on
+    bool Submit(ReadOp &op);
+};
+
+// Reads fd to the end without blocking the loop, then parses it. The read
+// buffer is owned by the task, hundreds of documents can be in flight on
+// one thread:
+//
+//   std::vector<Task<Json>> tasks;
+//   for (int fd : fds) {
+//       tasks.push_back(ParseAsync(loop, fd));
+//       loop.Spawn(tasks.back());
+//   }
+//   loop.Run();
+//   Json first = tasks[0].Result();
+Task<Json> ParseAsync(EventLoop &loop, int fd, ParserOptions options = {});
+} // namespace sjp
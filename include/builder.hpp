@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "json.hpp"
+
+namespace sjp {
+template <typename T>
+concept JsonLike = std::same_as<std::remove_cvref_t<T>, Json> || JVal<T>;
+
+// Scalars become a node of the matching type. Strings are taken in the
+// escaped form Json stores them in, like InsertOrUpdate.
+template <typename T>
+    requires JsonLike<T>
+Json ToJson(T &&val) {
+    using V = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<V, Json>) {
+        return std::forward<T>(val);
+    } else if constexpr (std::is_same_v<V, bool>) {
+        return {.type = JsonType::jbool,
+                .value = std::make_shared<JsonBool>(val)};
+    } else if constexpr (std::is_same_v<V, JNull>) {
+        return {.type = JsonType::jnull,
+                .value = std::make_shared<JsonNull>(val)};
+    } else if constexpr (std::is_arithmetic_v<V>) {
+        auto number = static_cast<double>(val);
+        return {.type = JsonType::jnumber,
+                .value = std::make_shared<JsonNumber>(number)};
+    } else {
+        return {.type = JsonType::jstring,
+                .value = std::make_shared<JsonString>(
+                    std::string(std::forward<T>(val)))};
+    }
+}
+
+// Any value ToJson accepts, for initializer lists.
+struct Value {
+    template <typename T>
+        requires JsonLike<T>
+    Value(T &&val) : json(ToJson(std::forward<T>(val))) {}
+
+    Json json;
+};
+
+// Builds an array in one allocation when the size is known up front.
+// Numbers and bools are kept packed for as long as every element added is of
+// the same kind, Json values are stored as they are.
+class ArrayBuilder {
+  public:
+    explicit ArrayBuilder(size_t reserve = 0) : reserve(reserve) {}
+
+    template <typename T>
+        requires JsonLike<T>
+    ArrayBuilder &Add(T &&val) {
+        using V = std::remove_cvref_t<T>;
+        if constexpr (std::is_same_v<V, bool>) {
+            if (Pack<bool>(val)) {
+                return *this;
+            }
+        } else if constexpr (std::is_arithmetic_v<V>) {
+            if (Pack<double>(static_cast<double>(val))) {
+                return *this;
+            }
+        }
+        Generic().push_back(ToJson(std::forward<T>(val)));
+        return *this;
+    }
+
+    size_t Size() const {
+        return std::visit([](auto &items) { return items.size(); }, items);
+    }
+
+    Json Build() && {
+        return std::visit(
+            [](auto &items) -> Json {
+                return {.type = JsonType::jarray,
+                        .value = std::make_shared<JsonArray>(std::move(items))};
+            },
+            items);
+    }
+
+  private:
+    size_t reserve;
+    std::variant<std::vector<Json>, std::vector<double>, std::vector<bool>>
+        items;
+
+    template <typename P> bool Pack(P val) {
+        if (items.index() == 0 && std::get<0>(items).empty()) {
+            items.emplace<std::vector<P>>().reserve(reserve);
+        }
+        if (auto *packed = std::get_if<std::vector<P>>(&items)) {
+            packed->push_back(val);
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<Json> &Generic() {
+        if (auto *generic = std::get_if<std::vector<Json>>(&items)) {
+            if (generic->empty()) {
+                generic->reserve(reserve);
+            }
+            return *generic;
+        }
+        std::vector<Json> generic;
+        generic.reserve(std::max(reserve, Size() + 1));
+        std::visit(
+            [&generic](auto &packed) {
+                using P = typename std::decay_t<decltype(packed)>::value_type;
+                if constexpr (!std::is_same_v<P, Json>) {
+                    for (P val : packed) {
+                        generic.push_back(ToJson(val));
+                    }
+                }
+            },
+            items);
+        return items.emplace<std::vector<Json>>(std::move(generic));
+    }
+};
+
+// Keys are moved into the object, a repeated key keeps the last value.
+class ObjectBuilder {
+  public:
+    explicit ObjectBuilder(size_t reserve = 0) { items.reserve(reserve); }
+
+    template <typename T>
+        requires JsonLike<T>
+    ObjectBuilder &Add(std::string key, T &&val) {
+        items.insert_or_assign(std::move(key), ToJson(std::forward<T>(val)));
+        return *this;
+    }
+
+    size_t Size() const { return items.size(); }
+
+    Json Build() && {
+        return {.type = JsonType::jobject,
+                .value = std::make_shared<JsonObject>(std::move(items))};
+    }
+
+  private:
+    std::unordered_map<std::string, Json> items;
+};
+
+// MakeArray(1, 2.5, "name", MakeArray(true, JNull{}))
+template <typename... T>
+    requires(JsonLike<T> && ...)
+Json MakeArray(T &&...vals) {
+    ArrayBuilder builder(sizeof...(T));
+    (builder.Add(std::forward<T>(vals)), ...);
+    return std::move(builder).Build();
+}
+
+// MakeObject({{"id", 7}, {"tags", MakeArray("a", "b")}})
+inline Json
+MakeObject(std::initializer_list<std::pair<std::string_view, Value>> members) {
+    ObjectBuilder builder(members.size());
+    for (auto &[key, val] : members) {
+        builder.Add(std::string(key), val.json);
+    }
+    return std::move(builder).Build();
+}
+} // namespace sjp
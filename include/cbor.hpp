@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "json.hpp"
+
+namespace sjp::cbor {
+// Appends the CBOR (RFC 8949) encoding of json to out. Integral numbers are
+// written as major type 0/1 integers, other numbers as float32 when that is
+// lossless and float64 otherwise.
+void Encode(const Json &json, std::string &out);
+
+std::string Encode(const Json &json);
+
+// Decodes one CBOR data item. Map keys must be text strings, byte strings
+// are decoded as strings, tags are skipped and undefined decodes as null.
+// Indefinite length strings, arrays and maps are supported.
+Json Decode(std::string_view bytes);
+} // namespace sjp::cbor
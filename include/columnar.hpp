@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sjp {
+enum class ColumnType { number, int64, boolean, string };
+
+struct ColumnSpec {
+    std::string name; // object key, in json escaped form
+    ColumnType type;
+};
+
+// One Arrow-style column. Only the buffer matching type is filled, null
+// rows hold a zero or empty value. Strings are stored unescaped back to
+// back in chars, row i spans offsets[i] to offsets[i + 1].
+struct Column {
+    std::string name;
+    ColumnType type;
+    size_t size = 0;
+    std::vector<double> numbers;
+    std::vector<int64_t> integers;
+    std::vector<uint8_t> booleans;
+    std::vector<uint32_t> offsets{0};
+    std::string chars;
+    std::vector<uint8_t> validity; // bit i set when row i is not null
+
+    bool IsValid(size_t row) const {
+        return (validity[row / 8] >> (row % 8)) & 1;
+    }
+
+    std::string_view String(size_t row) const {
+        return std::string_view(chars).substr(offsets[row],
+                                              offsets[row + 1] - offsets[row]);
+    }
+};
+
+struct Table {
+    size_t rows = 0;
+    std::vector<Column> columns; // in spec order
+
+    const Column *Find(std::string_view name) const;
+};
+
+// Pivots an array of objects straight into columns without building any
+// Json nodes. Keys outside the spec are skipped in the tokenizer, missing
+// keys and json null become null rows, a value of another type is an
+// error. int64 columns are read exactly from the digits, a fraction or a
+// value past int64 is a type mismatch.
+Table ExtractColumns(std::istream &json_stream,
+                     const std::vector<ColumnSpec> &spec);
+
+// Same over an in-memory document. With threads > 1 the array is split on
+// top-level element boundaries in one raw scan and the slices are
+// extracted in parallel, then concatenated in order.
+Table ExtractColumns(std::string_view json, const std::vector<ColumnSpec> &spec,
+                     unsigned threads = 1);
+} // namespace sjp
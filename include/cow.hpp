@@ -0,0 +1,70 @@
+#pragma once
+
+#include <concepts>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "json.hpp"
+
+namespace sjp {
+// One step of a path into a Json tree, either an object key or an array
+// index. Json::end as the last step of a path appends to an array.
+struct PathElement {
+    PathElement(std::string key) : value(std::move(key)) {}
+    PathElement(const char *key) : value(std::string(key)) {}
+    template <std::integral T>
+    PathElement(T idx) : value(static_cast<size_t>(idx)) {}
+
+    std::variant<std::string, size_t> value;
+};
+
+using Path = std::vector<PathElement>;
+
+// Persistent Json document. Copies share the whole tree and cost O(1), a
+// mutation clones only the nodes between the root and the changed value
+// that are still shared with another copy; everything else stays shared.
+//
+// Values handed out by Get alias the shared tree, they are returned const
+// and must not be mutated through a copy.
+class CowJson {
+  public:
+    CowJson(Json json) : root(std::move(json)) {}
+
+    void Dump(std::ostream &out = std::cout) const { root.Dump(out); }
+
+    size_t Size() const { return root.Size(); }
+
+    std::optional<const Json> Get(const Path &path) const;
+
+    template <typename T>
+        requires JVal<T>
+    void Set(const Path &path, T val) {
+        if constexpr (std::is_constructible_v<std::string, T>) {
+            Set(path, {.type = JsonType::jstring,
+                       .value = std::make_shared<JsonString>(std::move(val))});
+        } else if constexpr (std::is_same_v<bool, T>) {
+            Set(path, {.type = JsonType::jbool,
+                       .value = std::make_shared<JsonBool>(val)});
+        } else if constexpr (std::is_constructible_v<double, T>) {
+            Set(path, {.type = JsonType::jnumber,
+                       .value = std::make_shared<JsonNumber>(val)});
+        } else {
+            Set(path, {.type = JsonType::jnull,
+                       .value = std::make_shared<JsonNull>(val)});
+        }
+    }
+
+    // Replaces the value at path, or inserts it when the last step names a
+    // missing key or Json::end. The steps before it must exist.
+    void Set(const Path &path, Json json);
+
+    // Returns the underlying tree, for read-only use.
+    const Json &Root() const { return root; }
+
+  private:
+    Json root;
+};
+} // namespace sjp
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sjp {
+// Decompresses a gzip, zlib or zstd stream on a background thread while the
+// reading thread parses, so the two overlap. Decompressed data is handed
+// over in fixed-size chunks through a bounded single-producer
+// single-consumer ring, memory stays at chunk_size * chunks however large
+// the document is:
+//
+//   std::ifstream file("events.json.gz", std::ios::binary);
+//   DecompressStream stream(file);
+//   Parser parser(stream);
+//   Json json = parser.Parse();
+//
+// zstd needs the library built with SJP_WITH_ZSTD. Corrupt input throws from
+// the reading thread.
+class DecompressStreamBuf : public std::streambuf {
+  public:
+    enum class Codec { automatic, gzip, zstd };
+
+    // compressed must outlive the buffer and is only read by the
+    // background thread.
+    DecompressStreamBuf(std::istream &compressed,
+                        Codec codec = Codec::automatic,
+                        size_t chunk_size = 64 << 10, size_t chunks = 4);
+    ~DecompressStreamBuf() override;
+
+    DecompressStreamBuf(const DecompressStreamBuf &) = delete;
+    DecompressStreamBuf &operator=(const DecompressStreamBuf &) = delete;
+
+  private:
+    struct Chunk {
+        std::vector<char> data;
+        size_t size = 0; // 0 marks the end of the stream
+    };
+
+    std::istream &compressed;
+    Codec codec;
+    std::vector<Chunk> ring;
+    // chunks produced and consumed so far, the slot is the count modulo
+    // the ring size
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<bool> stop{false};
+    std::string error; // written before the end marker is published
+    bool reading = false; // a chunk is handed out to the get area
+    std::thread producer;
+
+    int_type underflow() override;
+
+    void Produce();
+    void Inflate(std::vector<char> &in);
+    void DecompressZstd(std::vector<char> &in);
+    // Chunk to fill next, nullptr once the reader is gone.
+    Chunk *Acquire();
+    void Publish(size_t size);
+    bool Fill(std::vector<char> &in);
+};
+
+// istream owning its DecompressStreamBuf. Decompression errors are rethrown
+// by the stream instead of only setting badbit.
+class DecompressStream : public std::istream {
+  public:
+    using Codec = DecompressStreamBuf::Codec;
+
+    explicit DecompressStream(std::istream &compressed,
+                              Codec codec = Codec::automatic,
+                              size_t chunk_size = 64 << 10, size_t chunks = 4)
+        : std::istream(nullptr), buf(compressed, codec, chunk_size, chunks) {
+        rdbuf(&buf);
+        exceptions(std::ios::badbit);
+    }
+
+  private:
+    DecompressStreamBuf buf;
+};
+} // namespace sjp
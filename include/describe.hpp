@@ -0,0 +1,302 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "escape.hpp"
+#include "tokenizer.hpp"
+
+// SJP_DESCRIBE(Type, field...) lists the members of a struct that map to
+// json object keys. It must appear in the namespace of Type. Described
+// structs can be read straight from the tokenizer with Deserialize and
+// written straight into a byte buffer with Serialize, no Json tree is built
+// on the way.
+//
+//   struct Point { double x; double y; };
+//   SJP_DESCRIBE(Point, x, y)
+//
+// Supported member types are bool, arithmetic types, std::string,
+// std::optional<T>, std::vector<T> and other described structs.
+#define SJP_DESCRIBE(Type, ...)                                                \
+    [[maybe_unused]] constexpr auto SjpDescribe(const Type *) {                \
+        return std::make_tuple(SJP_FOR_EACH(SJP_FIELD, Type, __VA_ARGS__));    \
+    }
+
+#define SJP_FIELD(Type, field)                                                 \
+    ::sjp::Field<Type, decltype(Type::field)> {                                \
+        #field, ",\"" #field "\":", &Type::field                               \
+    }
+
+#define SJP_CONCAT(a, b) SJP_CONCAT_IMPL(a, b)
+#define SJP_CONCAT_IMPL(a, b) a##b
+#define SJP_FOR_EACH(m, T, ...)                                                \
+    SJP_CONCAT(SJP_FOR_EACH_, SJP_COUNT(__VA_ARGS__))(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_1(m, T, x) m(T, x)
+#define SJP_FOR_EACH_2(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_1(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_3(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_2(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_4(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_3(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_5(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_4(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_6(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_5(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_7(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_6(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_8(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_7(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_9(m, T, x, ...)                                           \
+    m(T, x), SJP_FOR_EACH_8(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_10(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_9(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_11(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_10(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_12(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_11(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_13(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_12(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_14(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_13(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_15(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_14(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_16(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_15(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_17(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_16(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_18(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_17(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_19(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_18(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_20(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_19(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_21(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_20(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_22(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_21(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_23(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_22(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_24(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_23(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_25(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_24(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_26(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_25(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_27(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_26(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_28(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_27(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_29(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_28(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_30(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_29(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_31(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_30(m, T, __VA_ARGS__)
+#define SJP_FOR_EACH_32(m, T, x, ...)                                          \
+    m(T, x), SJP_FOR_EACH_31(m, T, __VA_ARGS__)
+#define SJP_COUNT(...)                                                         \
+    SJP_COUNT_N(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21,   \
+    20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define SJP_COUNT_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13,    \
+    _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, \
+    _29, _30, _31, _32, N, ...) N
+
+namespace sjp {
+template <typename Class, typename Member> struct Field {
+    std::string_view name;
+    // pre-escaped `,"name":` fragment, the first field drops the comma
+    std::string_view key;
+    Member Class::*member;
+};
+
+template <typename T>
+concept Described = requires(const T *ptr) { SjpDescribe(ptr); };
+
+namespace detail {
+template <Described T>
+inline constexpr auto fields_of = SjpDescribe(static_cast<const T *>(nullptr));
+
+template <typename> struct IsOptional : std::false_type {};
+template <typename T> struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <typename> struct IsVector : std::false_type {};
+template <typename T> struct IsVector<std::vector<T>> : std::true_type {};
+
+template <typename> inline constexpr bool unsupported_field = false;
+
+template <Described T> void ReadObject(Tokenizer &, T &);
+template <typename T> void ReadVector(Tokenizer &, std::vector<T> &);
+
+template <typename T> void ReadValue(Tokenizer &tokenizer, T &out) {
+    if constexpr (Described<T>) {
+        ReadObject(tokenizer, out);
+    } else if constexpr (IsOptional<T>::value) {
+        if (tokenizer.PeekToken().type == TokenType::jnull) {
+            tokenizer.GetToken();
+            out.reset();
+        } else {
+            ReadValue(tokenizer, out.emplace());
+        }
+    } else if constexpr (IsVector<T>::value) {
+        ReadVector(tokenizer, out);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        Token token =
+            Next(tokenizer, TokenType::quoted_str, "Expected quoted string");
+        out = Unescape(std::get<std::string>(token.value));
+    } else if constexpr (std::is_same_v<T, bool>) {
+        Token token = Next(tokenizer, TokenType::jbool, "Expected true|false");
+        out = std::get<bool>(token.value);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        Token token = Next(tokenizer, TokenType::number, "Expected a number");
+        double number = std::get<double>(token.value);
+        if constexpr (std::is_integral_v<T>) {
+            if (number != std::trunc(number) ||
+                number < static_cast<double>(std::numeric_limits<T>::min()) ||
+                number >=
+                    static_cast<double>(std::numeric_limits<T>::max()) + 1.0) {
+                THROW_ERROR("Error parsing json number - not representable");
+            }
+        }
+        out = static_cast<T>(number);
+    } else {
+        static_assert(unsupported_field<T>, "Unsupported field type");
+    }
+}
+
+template <typename T>
+void ReadVector(Tokenizer &tokenizer, std::vector<T> &out) {
+    Next(tokenizer, TokenType::left_bracket,
+         "Error parsing json arry - expected '['");
+    out.clear();
+    while (tokenizer.PeekToken().type != TokenType::right_bracket) {
+        ReadValue(tokenizer, out.emplace_back());
+        Separator(tokenizer, TokenType::right_bracket);
+    }
+    tokenizer.GetToken();
+}
+
+// Field names are compile time constants, comparing the length first lets
+// most mismatches bail out before touching the key bytes.
+template <typename T, typename Member>
+bool ReadIfMatch(Tokenizer &tokenizer, const std::string &key, T &out,
+                 const Field<T, Member> &field) {
+    if (key.size() != field.name.size() ||
+        std::memcmp(key.data(), field.name.data(), key.size()) != 0) {
+        return false;
+    }
+    ReadValue(tokenizer, out.*field.member);
+    return true;
+}
+
+template <Described T> void ReadObject(Tokenizer &tokenizer, T &out) {
+    Next(tokenizer, TokenType::left_braces,
+         "Error parsing json object - expected '{'");
+    while (tokenizer.PeekToken().type != TokenType::right_braces) {
+        Token token = Next(tokenizer, TokenType::quoted_str,
+                           "Error parsing json object - invalid key");
+        Next(tokenizer, TokenType::colon,
+             "Error parsing json object - expected ':'");
+
+        const auto &key = std::get<std::string>(token.value);
+        bool matched = std::apply(
+            [&](const auto &...fields) {
+                return (ReadIfMatch(tokenizer, key, out, fields) || ...);
+            },
+            fields_of<T>);
+        if (!matched) {
+            tokenizer.SkipValue();
+        }
+
+        Separator(tokenizer, TokenType::right_braces);
+    }
+    tokenizer.GetToken();
+}
+template <typename T> void WriteObject(std::string &, const T &);
+
+template <typename T> void WriteValue(std::string &out, const T &val) {
+    if constexpr (Described<T>) {
+        WriteObject(out, val);
+    } else if constexpr (IsOptional<T>::value) {
+        if (val.has_value()) {
+            WriteValue(out, *val);
+        } else {
+            out += "null";
+        }
+    } else if constexpr (IsVector<T>::value) {
+        out += '[';
+        for (size_t i = 0; i < val.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            WriteValue(out, val[i]);
+        }
+        out += ']';
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        out += '"';
+        AppendEscaped(out, val);
+        out += '"';
+    } else if constexpr (std::is_same_v<T, bool>) {
+        out += val ? "true" : "false";
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        if constexpr (std::is_floating_point_v<T>) {
+            if (!std::isfinite(val)) {
+                out += "null";
+                return;
+            }
+        }
+        char buf[32];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), val);
+        out.append(buf, end);
+    } else {
+        static_assert(unsupported_field<T>, "Unsupported field type");
+    }
+}
+
+template <typename T> void WriteObject(std::string &out, const T &val) {
+    out += '{';
+    bool first = true;
+    std::apply(
+        [&](const auto &...fields) {
+            ((out += fields.key.substr(first ? 1 : 0), first = false,
+              WriteValue(out, val.*fields.member)),
+             ...);
+        },
+        fields_of<T>);
+    out += '}';
+}
+} // namespace detail
+
+// Reads one json object into out. Unknown keys are skipped, members without
+// a matching key keep their current value.
+template <Described T> void Deserialize(Tokenizer &tokenizer, T &out) {
+    detail::ReadObject(tokenizer, out);
+}
+
+template <Described T> T Deserialize(std::istream &json_stream) {
+    Tokenizer tokenizer(json_stream);
+    T out{};
+    Deserialize(tokenizer, out);
+    detail::Next(tokenizer, TokenType::end, "Invalid JSON String");
+    return out;
+}
+
+// Appends val as a compact json object to out.
+template <Described T> void Serialize(const T &val, std::string &out) {
+    detail::WriteObject(out, val);
+}
+
+template <Described T> std::string Serialize(const T &val) {
+    std::string out;
+    Serialize(val, out);
+    return out;
+}
+} // namespace sjp
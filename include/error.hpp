@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <format>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+#define THROW_ERROR(msg)                                                       \
+    throw std::runtime_error(                                                  \
+        std::format("{} at {} in {}.", msg, __LINE__, __FILE__));
+
+namespace sjp {
+enum class ParseErrorCode {
+    unexpected_end,
+    unexpected_token,
+    invalid_number,
+    number_out_of_range,
+    invalid_comment,
+    duplicate_key,
+    schema_violation, // see ParserOptions::schema
+    memory_limit      // see ParserOptions::max_allocation
+};
+
+struct ParseError {
+    ParseErrorCode code;
+    size_t offset; // byte offset into the input
+    size_t line;   // 1-based
+    size_t column; // 1-based, in bytes
+    const char *message;
+};
+
+// Minimal stand-in for C++23 std::expected<T, ParseError>, with the same
+// member names so callers can switch over once the toolchain allows it.
+template <typename T> class Expected {
+  public:
+    Expected(T val) : storage(std::in_place_index<0>, std::move(val)) {}
+    Expected(ParseError err) : storage(std::in_place_index<1>, err) {}
+
+    bool has_value() const { return storage.index() == 0; }
+    explicit operator bool() const { return has_value(); }
+
+    T &value() & {
+        Check();
+        return std::get<0>(storage);
+    }
+    const T &value() const & {
+        Check();
+        return std::get<0>(storage);
+    }
+    T &&value() && {
+        Check();
+        return std::get<0>(std::move(storage));
+    }
+
+    T &operator*() & { return std::get<0>(storage); }
+    const T &operator*() const & { return std::get<0>(storage); }
+    T &&operator*() && { return std::get<0>(std::move(storage)); }
+    T *operator->() { return &std::get<0>(storage); }
+    const T *operator->() const { return &std::get<0>(storage); }
+
+    const ParseError &error() const { return std::get<1>(storage); }
+
+  private:
+    std::variant<T, ParseError> storage;
+
+    void Check() const {
+        if (!has_value()) {
+            THROW_ERROR(error().message);
+        }
+    }
+};
+} // namespace sjp
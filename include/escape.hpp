@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sjp {
+// Strings are stored the way they appear between the quotes of the source
+// document. Unescape decodes them into plain UTF-8 text.
+std::string Unescape(std::string_view str);
+
+// Appends str to out with the characters json requires to be escaped
+// replaced by their escape sequences. Quotes are not added.
+void AppendEscaped(std::string &out, std::string_view str);
+
+// Splits an RFC 6901 pointer into its reference tokens, with ~1 and ~0
+// decoded. Throws on a malformed pointer.
+std::vector<std::string> PointerTokens(std::string_view pointer);
+} // namespace sjp
@@ -1,14 +1,21 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <cmath>
 #include <concepts>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <ostream>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
 #define ESCAPE(x) "\"" << (x) << "\""
@@ -17,6 +24,14 @@ namespace sjp {
 enum class JsonType { jstring, jnumber, jnull, jbool, jobject, jarray };
 
 struct JNull {};
+
+// nullopt unless number is integral and fits
+inline std::optional<int64_t> ToInt64(double number) {
+    if (std::trunc(number) != number || number < -0x1p63 || number >= 0x1p63) {
+        return std::nullopt;
+    }
+    return static_cast<int64_t>(number);
+}
 template <typename> class JsonValue;
 using JsonNumber = JsonValue<double>;
 using JsonString = JsonValue<std::string>;
@@ -26,6 +41,87 @@ using JsonNull = JsonValue<JNull>;
 class Base;
 template <JsonType> std::shared_ptr<Base> BaseBuilder();
 
+// Structural hash of a container, 0 until computed. Each container links
+// to the cache of the container holding it, so a mutation clears the hashes
+// of its ancestors and nothing else. Links are made while hashing. A
+// container found under two parents is marked shared and its ancestors stop
+// caching, they rehash their direct children instead. Relaxed atomics make
+// Hash and == safe on a document read by several threads.
+struct HashCache {
+    std::atomic<uint64_t> hash{0};
+    std::atomic<HashCache *> parent{nullptr};
+
+    HashCache() = default;
+    // a copy holds the same children but is not linked to them
+    HashCache(const HashCache &) {}
+    HashCache &operator=(const HashCache &) { return *this; }
+
+    static HashCache *Shared() {
+        static HashCache shared;
+        return &shared;
+    }
+
+    // Stops at the first hash already cleared, its ancestors are too.
+    void Invalidate() {
+        HashCache *cache = this;
+        while (cache && cache != Shared() && cache->hash.exchange(0)) {
+            cache = cache->parent.load();
+        }
+    }
+
+    // Links child under this, false if it is held by another container.
+    bool Adopt(HashCache &child) {
+        HashCache *owner = nullptr;
+        if (child.parent.compare_exchange_strong(owner, this) ||
+            owner == this) {
+            return true;
+        }
+        if (owner != Shared()) {
+            // its mutations no longer reach the old parent. Unlinked first,
+            // so a hash the old parent stores concurrently is either cleared
+            // here or sees the unlink, see Json::Hash.
+            child.parent.store(Shared());
+            owner->Invalidate();
+        }
+        return false;
+    }
+
+    // For children leaving this container, nullptr for scalars.
+    void Release(HashCache *child) {
+        HashCache *owner = this;
+        if (child) {
+            child->parent.compare_exchange_strong(owner, nullptr,
+                                                  std::memory_order_relaxed);
+        }
+    }
+};
+
+// Heap bytes held by a Json, by where they go. The sizes follow libstdc++
+// and assume nodes made with make_shared, allocator overhead is not counted.
+struct MemoryUsage {
+    size_t nodes = 0;          // the value objects themselves
+    size_t control_blocks = 0; // shared_ptr reference counts
+    size_t strings = 0;        // string buffers past the inline capacity
+    size_t arrays = 0;         // vector capacity of arrays
+    size_t object_nodes = 0;   // unordered_map nodes of objects
+    size_t buckets = 0;        // unordered_map bucket arrays
+
+    size_t Total() const {
+        return nodes + control_blocks + strings + arrays + object_nodes +
+               buckets;
+    }
+
+    MemoryUsage &operator+=(const MemoryUsage &other) {
+        nodes += other.nodes;
+        control_blocks += other.control_blocks;
+        strings += other.strings;
+        arrays += other.arrays;
+        object_nodes += other.object_nodes;
+        buckets += other.buckets;
+        return *this;
+    }
+};
+
 template <typename T>
 concept JVal =
     std::constructible_from<std::string, T> ||
@@ -41,6 +137,15 @@ class Base {
 
         void Dump(std::ostream &out = std::cout) const { value->Print(out); }
 
+        // Same bytes as Dump, rendered on threads workers. Large containers
+        // are split into chunks of about grain values, each printed into its
+        // own buffer with the formatting of out, and written in order as
+        // they complete. Workers stay at most 2 * threads chunks ahead of
+        // the writer, so a slow out holds back rendering instead of memory
+        // filling up.
+        void ParallelDump(std::ostream &out, unsigned threads,
+                          size_t grain = 4096) const;
+
         size_t Size() const { return value->Size(); }
 
         std::optional<Json> Get(size_t idx) const { // json-array
@@ -58,6 +163,8 @@ class Base {
                 return value->GetBool();
             } else if constexpr (std::is_same_v<RetType, double>) {
                 return value->GetNumber();
+            } else if constexpr (std::is_same_v<RetType, int64_t>) {
+                return value->GetInt64();
             } else {
                 return std::nullopt;
             }
@@ -113,6 +220,26 @@ class Base {
             InsertOrUpdateJson(std::move(key), std::move(json));
         }
 
+        // Independent of object key order, strings and keys are hashed and
+        // compared in the escaped form they are stored in. Containers cache
+        // their hash until they or a descendant change, see HashCache. Safe
+        // to call from several threads while nobody mutates the document.
+        uint64_t Hash() const;
+        bool operator==(const Json &other) const;
+
+        // The whole tree, nodes shared within it are counted once.
+        sjp::MemoryUsage MemoryUsage() const;
+        // This node alone, without the nodes of its children.
+        sjp::MemoryUsage NodeMemoryUsage() const;
+
+        // RFC 6902 JSON Patch, applied in place. Every operation is recorded
+        // in an undo log, a failing operation rolls the whole patch back and
+        // throws. Values taken from the patch are deep copies.
+        void ApplyPatch(const Json &patch);
+
+        // RFC 7386 JSON Merge Patch, applied in place.
+        void ApplyMergePatch(const Json &patch);
+
       private:
         void AppendOrUpdateBool(size_t, bool);
         void AppendOrUpdateNull(size_t, JNull);
@@ -129,20 +256,27 @@ class Base {
     virtual ~Base() = default;
     void Print(std::ostream &out) const { PrintImpl(out); }
     size_t Size() const { return SizeImpl(); }
+    // Shallow copy, the children of containers are shared with the original.
+    std::shared_ptr<Base> Clone() const { return CloneImpl(); }
+    // nullptr for scalars
+    virtual HashCache *Cache() const { return nullptr; }
 
   private:
     virtual void PrintImpl(std::ostream &) const = 0;
+    virtual std::shared_ptr<Base> CloneImpl() const = 0;
     virtual std::optional<Json> Get(size_t) { return std::nullopt; }
     virtual std::optional<Json> Get(std::string) { return std::nullopt; }
     virtual std::optional<std::string> GetString() { return std::nullopt; }
     virtual std::optional<double> GetNumber() { return std::nullopt; }
+    // Only for integral numbers that fit.
+    virtual std::optional<int64_t> GetInt64() { return std::nullopt; }
     virtual std::optional<bool> GetBool() { return std::nullopt; }
     virtual size_t SizeImpl() const { return 0; }
 };
 
 template <typename ValueType> class JsonValue : public Base {
   public:
-    JsonValue(ValueType val) : value(val) {}
+    JsonValue(ValueType val) : value(std::move(val)) {}
     ValueType value;
 
   private:
@@ -158,6 +292,10 @@ template <typename ValueType> class JsonValue : public Base {
         }
     }
 
+    std::shared_ptr<Base> CloneImpl() const override {
+        return std::make_shared<JsonValue>(*this);
+    }
+
     std::optional<std::string> GetString() override {
         if constexpr (std::is_same_v<ValueType, std::string>) {
             return value;
@@ -181,76 +319,368 @@ template <typename ValueType> class JsonValue : public Base {
             return std::nullopt;
         }
     }
+
+    std::optional<int64_t> GetInt64() override {
+        if constexpr (std::is_same_v<ValueType, double>) {
+            return ToInt64(value);
+        } else {
+            return std::nullopt;
+        }
+    }
+};
+
+// Number kept as its source digits and converted on every read, so reads
+// never mutate the node. Dump echoes the digits verbatim.
+class JsonLazyNumber : public Base {
+  public:
+    JsonLazyNumber(std::string lexeme) : lexeme(std::move(lexeme)) {}
+
+    const std::string &Lexeme() const { return lexeme; }
+
+  private:
+    std::string lexeme;
+
+    void PrintImpl(std::ostream &out) const override { out << lexeme; }
+
+    std::shared_ptr<Base> CloneImpl() const override {
+        return std::make_shared<JsonLazyNumber>(*this);
+    }
+
+    std::optional<double> GetNumber() override {
+        double val;
+        const char *end = lexeme.data() + lexeme.size();
+        auto [ptr, ec] = std::from_chars(lexeme.data(), end, val);
+        // out of range saturates like strtod
+        return ec == std::errc() ? val : std::strtod(lexeme.c_str(), nullptr);
+    }
+
+    // Plain integers are read exactly, beyond the 2^53 a double holds.
+    std::optional<int64_t> GetInt64() override {
+        int64_t val;
+        const char *end = lexeme.data() + lexeme.size();
+        auto [ptr, ec] = std::from_chars(lexeme.data(), end, val);
+        if (ec == std::errc() && ptr == end) {
+            return val;
+        }
+        return ToInt64(*GetNumber());
+    }
 };
 
 class JsonObject : public Base {
   public:
     JsonObject(std::unordered_map<std::string, Json> val)
         : value(std::move(val)) {}
+    JsonObject(const JsonObject &) = default;
+
+    ~JsonObject() override {
+        for (auto &[key, val] : value) {
+            Release(val);
+        }
+    }
 
     void InsertOrUpdate(std::string key, Json val) {
-        value[key] = std::move(val);
+        hash_cache.Invalidate();
+        // val is left alone when the key is present
+        auto [it, inserted] =
+            value.try_emplace(std::move(key), std::move(val));
+        if (!inserted) {
+            Release(it->second);
+            it->second = std::move(val);
+        }
+    }
+
+    const std::unordered_map<std::string, Json> &Items() const {
+        return value;
+    }
+
+    // The slot may be assigned, so its value is unlinked until the next
+    // Hash.
+    Json *Find(const std::string &key) {
+        hash_cache.Invalidate();
+        auto it = value.find(key);
+        if (it == value.end()) {
+            return nullptr;
+        }
+        Release(it->second);
+        return &it->second;
+    }
+
+    using Member = std::unordered_map<std::string, Json>::const_iterator;
+
+    // Heap bytes of a member besides its value: the map node and the key,
+    // counted like Json::MemoryUsage.
+    static size_t MemberMemory(const std::string &key);
+
+    // The members in [first, last) as Dump prints them, with the separator
+    // before first unless it is the first member. Lets a dump be split.
+    void PrintMembers(std::ostream &out, Member first, Member last) const {
+        for (auto i = first; i != last; ++i) {
+            if (i != value.begin()) {
+                out << ", ";
+            }
+            auto &[key, val] = *i;
+            out << ESCAPE(key) << ": ";
+            val.value->Print(out);
+        }
+    }
+
+    // nullopt if key is not present
+    std::optional<Json> Erase(const std::string &key) {
+        hash_cache.Invalidate();
+        auto node = value.extract(key);
+        if (node.empty()) {
+            return std::nullopt;
+        }
+        Release(node.mapped());
+        return std::move(node.mapped());
     }
 
+    HashCache *Cache() const override { return &hash_cache; }
+
   private:
     std::unordered_map<std::string, Json> value;
+    mutable HashCache hash_cache;
+
+    void Release(const Json &json) {
+        if (json.value) {
+            hash_cache.Release(json.value->Cache());
+        }
+    }
 
     void PrintImpl(std::ostream &out) const override {
         out << "{";
-        if (!value.empty()) {
-            auto &[key, val] = *value.begin();
-            out << ESCAPE(key) << ": ";
-            val.value->Print(out);
-            for (auto i = ++value.begin(); i != value.end(); ++i) {
-                out << ", ";
-                auto &[key, val] = *i;
-                out << ESCAPE(key) << ": ";
-                val.value->Print(out);
-            }
-        }
+        PrintMembers(out, value.begin(), value.end());
         out << "}";
     }
 
+    std::shared_ptr<Base> CloneImpl() const override {
+        return std::make_shared<JsonObject>(*this);
+    }
+
     size_t SizeImpl() const override { return value.size(); }
 
     std::optional<Json> Get(std::string key) override {
-        return value.contains(key) ? std::optional(value[key]) : std::nullopt;
+        auto it = value.find(key);
+        return it != value.end() ? std::optional(it->second) : std::nullopt;
     }
 };
 
+// Arrays holding only numbers or only bools are kept packed, without a node
+// per element. Any mutation that would break that promotes the array to
+// the generic form.
 class JsonArray : public Base {
   public:
+    enum class Storage { generic, numbers, bools };
+
     JsonArray(std::vector<Json> val) : value(std::move(val)) {}
+    JsonArray(std::vector<double> val) : value(std::move(val)) {}
+    JsonArray(std::vector<bool> val) : value(std::move(val)) {}
+    JsonArray(const JsonArray &) = default;
+
+    ~JsonArray() override {
+        if (auto *items = std::get_if<std::vector<Json>>(&value)) {
+            for (auto &item : *items) {
+                Release(item);
+            }
+        }
+    }
 
     void AppendOrUpdate(size_t idx, Json json) {
-        if (idx < value.size()) {
-            value[idx] = std::move(json);
+        hash_cache.Invalidate();
+        if (auto *numbers = std::get_if<std::vector<double>>(&value);
+            numbers && json.type == JsonType::jnumber) {
+            Put(*numbers, idx, *json.Get<double>());
+        } else if (auto *bools = std::get_if<std::vector<bool>>(&value);
+                   bools && json.type == JsonType::jbool) {
+            Put(*bools, idx, *json.Get<bool>());
+        } else {
+            auto &items = Promote();
+            if (idx < items.size()) {
+                Release(items[idx]);
+            }
+            Put(items, idx, std::move(json));
+        }
+    }
+
+    Storage Packing() const { return static_cast<Storage>(value.index()); }
+
+    // Element slots allocated by the current storage.
+    size_t Capacity() const {
+        return std::visit([](auto &items) { return items.capacity(); },
+                          value);
+    }
+
+    // Only valid for the matching Packing().
+    const std::vector<Json> &Items() const {
+        assert(Packing() == Storage::generic);
+        return std::get<std::vector<Json>>(value);
+    }
+
+    std::span<const double> Numbers() const {
+        assert(Packing() == Storage::numbers);
+        return std::get<std::vector<double>>(value);
+    }
+
+    const std::vector<bool> &Bools() const {
+        assert(Packing() == Storage::bools);
+        return std::get<std::vector<bool>>(value);
+    }
+
+    // The elements in [begin, end) as Dump prints them, with the separator
+    // before begin unless it is 0. Lets a dump be split.
+    void PrintElements(std::ostream &out, size_t begin, size_t end) const {
+        std::visit(
+            [&](auto &items) {
+                for (size_t i = begin; i < end; ++i) {
+                    if (i) {
+                        out << ", ";
+                    }
+                    if constexpr (std::is_same_v<std::decay_t<decltype(items)>,
+                                                 std::vector<Json>>) {
+                        items[i].value->Print(out);
+                    } else if constexpr (std::is_same_v<
+                                             std::decay_t<decltype(items)>,
+                                             std::vector<bool>>) {
+                        out << (items[i] ? "true" : "false");
+                    } else {
+                        out << items[i];
+                    }
+                }
+            },
+            value);
+    }
+
+    // The returned element may be mutated in place, so a packed array is
+    // promoted first. Like JsonObject::Find, the slot is unlinked.
+    Json *Find(size_t idx) {
+        hash_cache.Invalidate();
+        auto &items = Promote();
+        if (idx >= items.size()) {
+            return nullptr;
+        }
+        Release(items[idx]);
+        return &items[idx];
+    }
+
+    // Shifts the elements from idx on, idx == Size() appends.
+    void Insert(size_t idx, Json json) {
+        assert(idx <= SizeImpl());
+        hash_cache.Invalidate();
+        if (auto *numbers = std::get_if<std::vector<double>>(&value);
+            numbers && json.type == JsonType::jnumber) {
+            numbers->insert(numbers->begin() + static_cast<ptrdiff_t>(idx),
+                            *json.Get<double>());
+        } else if (auto *bools = std::get_if<std::vector<bool>>(&value);
+                   bools && json.type == JsonType::jbool) {
+            bools->insert(bools->begin() + static_cast<ptrdiff_t>(idx),
+                          *json.Get<bool>());
         } else {
-            value.push_back(std::move(json));
+            auto &items = Promote();
+            items.insert(items.begin() + static_cast<ptrdiff_t>(idx),
+                         std::move(json));
         }
     }
 
+    // Removes and returns the element at idx.
+    Json Erase(size_t idx) {
+        assert(idx < SizeImpl());
+        hash_cache.Invalidate();
+        return std::visit(
+            [this, idx](auto &items) {
+                using T = typename std::decay_t<decltype(items)>::value_type;
+                auto it = items.begin() + static_cast<ptrdiff_t>(idx);
+                Json json = [this, &it]() -> Json {
+                    if constexpr (std::is_same_v<T, Json>) {
+                        Release(*it);
+                        return std::move(*it);
+                    } else {
+                        return Element(static_cast<T>(*it));
+                    }
+                }();
+                items.erase(it);
+                return json;
+            },
+            value);
+    }
+
+    HashCache *Cache() const override { return &hash_cache; }
+
   private:
-    std::vector<Json> value;
+    std::variant<std::vector<Json>, std::vector<double>, std::vector<bool>>
+        value;
+    mutable HashCache hash_cache;
 
-    void PrintImpl(std::ostream &out) const override {
-        out << "[";
-        if (!value.empty()) {
-            auto &val = value[0];
-            val.value->Print(out);
-            for (size_t i = 1; i < value.size(); ++i) {
-                out << ", ";
-                auto &val = value[i];
-                val.value->Print(out);
+    void Release(const Json &json) {
+        if (json.value) {
+            hash_cache.Release(json.value->Cache());
+        }
+    }
+
+    template <typename T, typename V>
+    static void Put(std::vector<T> &items, size_t idx, V &&val) {
+        if (idx < items.size()) {
+            items[idx] = std::forward<V>(val);
+        } else {
+            items.push_back(std::forward<V>(val));
+        }
+    }
+
+    template <typename T> static Json Element(T val) {
+        if constexpr (std::is_same_v<T, double>) {
+            return {.type = JsonType::jnumber,
+                    .value = std::make_shared<JsonNumber>(val)};
+        } else {
+            return {.type = JsonType::jbool,
+                    .value = std::make_shared<JsonBool>(val)};
+        }
+    }
+
+    std::vector<Json> &Promote() {
+        if (auto *items = std::get_if<std::vector<Json>>(&value)) {
+            return *items;
+        }
+        std::vector<Json> items;
+        items.reserve(SizeImpl());
+        if (auto *numbers = std::get_if<std::vector<double>>(&value)) {
+            for (double val : *numbers) {
+                items.push_back(Element(val));
+            }
+        } else {
+            for (bool val : std::get<std::vector<bool>>(value)) {
+                items.push_back(Element(val));
             }
         }
+        return value.emplace<std::vector<Json>>(std::move(items));
+    }
+
+    void PrintImpl(std::ostream &out) const override {
+        out << "[";
+        PrintElements(out, 0, SizeImpl());
         out << "]";
     }
 
-    size_t SizeImpl() const override { return value.size(); }
+    std::shared_ptr<Base> CloneImpl() const override {
+        return std::make_shared<JsonArray>(*this);
+    }
+
+    size_t SizeImpl() const override {
+        return std::visit([](auto &items) { return items.size(); }, value);
+    }
 
     std::optional<Json> Get(size_t idx) override {
-        return idx < value.size() ? std::optional(value[idx]) : std::nullopt;
+        if (idx >= SizeImpl()) {
+            return std::nullopt;
+        }
+        switch (Packing()) {
+        case Storage::numbers:
+            return Element(std::get<std::vector<double>>(value)[idx]);
+        case Storage::bools:
+            return Element(
+                static_cast<bool>(std::get<std::vector<bool>>(value)[idx]));
+        case Storage::generic:
+            break;
+        }
+        return std::get<std::vector<Json>>(value)[idx];
     }
 };
 
@@ -265,9 +695,9 @@ template <JsonType type> std::shared_ptr<Base> BaseBuilder() {
     } else if constexpr (type == JsonType::jstring) {
         return std::make_shared<JsonString>("");
     } else if constexpr (type == JsonType::jnumber) {
-        return std::make_shared<JsonString>(0.0);
+        return std::make_shared<JsonNumber>(0.0);
     } else if constexpr (type == JsonType::jbool) {
-        return std::make_shared<JsonString>(false);
+        return std::make_shared<JsonBool>(false);
     } else {
         return std::make_shared<JsonNull>(JNull{});
     }
@@ -279,71 +709,76 @@ template <JsonType type> Json JsonBuilder() {
 
 __attribute__((__always_inline__)) inline void
 Json::AppendOrUpdateBool(size_t idx, bool val) {
-    auto ptr = std::static_pointer_cast<JsonArray>(value);
-    ptr->AppendOrUpdate(idx, {.type = JsonType::jbool,
-                              .value = std::make_shared<JsonBool>(val)});
+    static_cast<JsonArray &>(*value).AppendOrUpdate(
+        idx, {.type = JsonType::jbool,
+              .value = std::make_shared<JsonBool>(val)});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::AppendOrUpdateNull(size_t idx, JNull val) {
-    auto ptr = std::static_pointer_cast<JsonArray>(value);
-    ptr->AppendOrUpdate(idx, {.type = JsonType::jnull,
-                              .value = std::make_shared<JsonNull>(val)});
+    static_cast<JsonArray &>(*value).AppendOrUpdate(
+        idx, {.type = JsonType::jnull,
+              .value = std::make_shared<JsonNull>(val)});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::AppendOrUpdateNumber(size_t idx, double val) {
-    auto ptr = std::static_pointer_cast<JsonArray>(value);
-    ptr->AppendOrUpdate(idx, {.type = JsonType::jnumber,
-                              .value = std::make_shared<JsonNumber>(val)});
+    static_cast<JsonArray &>(*value).AppendOrUpdate(
+        idx, {.type = JsonType::jnumber,
+              .value = std::make_shared<JsonNumber>(val)});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::AppendOrUpdateString(size_t idx, std::string val) {
-    auto ptr = std::static_pointer_cast<JsonArray>(value);
-    ptr->AppendOrUpdate(
+    static_cast<JsonArray &>(*value).AppendOrUpdate(
         idx, {.type = JsonType::jstring,
               .value = std::make_shared<JsonString>(std::move(val))});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::AppendOrUpdateJson(size_t idx, Json json) {
-    auto ptr = std::static_pointer_cast<JsonArray>(value);
-    ptr->AppendOrUpdate(idx, std::move(json));
+    static_cast<JsonArray &>(*value).AppendOrUpdate(idx, std::move(json));
 }
 
 __attribute__((__always_inline__)) inline void
 Json::InsertOrUpdateBool(std::string key, bool val) {
-    auto ptr = std::static_pointer_cast<JsonObject>(value);
-    ptr->InsertOrUpdate(key, {.type = JsonType::jnull,
-                              .value = std::make_shared<JsonBool>(val)});
+    static_cast<JsonObject &>(*value).InsertOrUpdate(
+        std::move(key),
+        {.type = JsonType::jbool,
+         .value = std::make_shared<JsonBool>(val)});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::InsertOrUpdateNull(std::string key, JNull val) {
-    auto ptr = std::static_pointer_cast<JsonObject>(value);
-    ptr->InsertOrUpdate(key, {.type = JsonType::jnull,
-                              .value = std::make_shared<JsonNull>(val)});
+    static_cast<JsonObject &>(*value).InsertOrUpdate(
+        std::move(key),
+        {.type = JsonType::jnull,
+         .value = std::make_shared<JsonNull>(val)});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::InsertOrUpdateNumber(std::string key, double val) {
-    auto ptr = std::static_pointer_cast<JsonObject>(value);
-    ptr->InsertOrUpdate(key, {.type = JsonType::jnull,
-                              .value = std::make_shared<JsonNumber>(val)});
+    static_cast<JsonObject &>(*value).InsertOrUpdate(
+        std::move(key),
+        {.type = JsonType::jnumber,
+         .value = std::make_shared<JsonNumber>(val)});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::InsertOrUpdateString(std::string key, std::string val) {
-    auto ptr = std::static_pointer_cast<JsonObject>(value);
-    ptr->InsertOrUpdate(
-        key, {.type = JsonType::jnull,
-              .value = std::make_shared<JsonString>(std::move(val))});
+    static_cast<JsonObject &>(*value).InsertOrUpdate(
+        std::move(key),
+        {.type = JsonType::jstring,
+         .value = std::make_shared<JsonString>(std::move(val))});
 }
 
 __attribute__((__always_inline__)) inline void
 Json::InsertOrUpdateJson(std::string key, Json json) {
-    auto ptr = std::static_pointer_cast<JsonObject>(value);
-    ptr->InsertOrUpdate(key, std::move(json));
+    static_cast<JsonObject &>(*value).InsertOrUpdate(std::move(key),
+                                                     std::move(json));
 }
 } // namespace sjp
+
+template <> struct std::hash<sjp::Json> {
+    size_t operator()(const sjp::Json &json) const { return json.Hash(); }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "json.hpp"
+
+namespace sjp::msgpack {
+// Appends the MessagePack encoding of json to out. Integral numbers are
+// written with the smallest integer format that holds them, other numbers
+// as float32 when that is lossless and float64 otherwise.
+void Encode(const Json &json, std::string &out);
+
+std::string Encode(const Json &json);
+
+// Decodes one MessagePack value. Map keys must be strings, bin values are
+// decoded as strings, ext values are rejected.
+Json Decode(std::string_view bytes);
+} // namespace sjp::msgpack
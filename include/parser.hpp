@@ -2,24 +2,170 @@
 
 #include "json.hpp"
 #include "tokenizer.hpp"
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
 namespace sjp {
+class Schema;
+
+// Prefix tree of the fields to build, given as RFC 6901 pointers, e.g.
+// {"/meta/host", "/metrics"}. A path ending at a node builds its whole
+// subtree. Arrays are transparent, "/events/id" keeps "id" in every element
+// of "events".
+class Projection {
+  public:
+    Projection() = default;
+    Projection(std::initializer_list<std::string_view> paths) {
+        for (auto path : paths) {
+            Add(path);
+        }
+    }
+
+    void Add(std::string_view path);
+
+    // nullptr if key is not projected
+    const Projection *Find(const std::string &key) const {
+        auto it = children.find(key);
+        return it == children.end() ? nullptr : &it->second;
+    }
+
+    bool Leaf() const { return leaf; }
+
+  private:
+    std::map<std::string, Projection> children;
+    bool leaf = false;
+};
+
+// Shares one node between repeated short string values, e.g. log levels or
+// host names, so each distinct value is allocated once. Values longer than
+// max_length are never interned, and once max_entries values are held new
+// ones get their own node. A table may be reused across parses on the
+// thread that owns it.
+class StringTable {
+  public:
+    explicit StringTable(size_t max_entries = 4096, size_t max_length = 32)
+        : max_entries(max_entries), max_length(max_length) {}
+
+    std::shared_ptr<JsonString> Intern(std::string str);
+
+    size_t Size() const { return nodes.size(); }
+
+  private:
+    // keys view the string held by their node
+    std::unordered_map<std::string_view, std::shared_ptr<JsonString>> nodes;
+    size_t max_entries;
+    size_t max_length;
+};
+
+struct ParserOptions {
+    // Only the projected fields are built, everything else is skipped in
+    // the tokenizer. Must outlive the parser.
+    const Projection *projection = nullptr;
+
+    // Numbers keep their source digits and are converted when read,
+    // see JsonLazyNumber. Number arrays are then not packed.
+    bool lazy_numbers = false;
+
+    // String values are interned in this table. Must outlive the parser.
+    StringTable *strings = nullptr;
+
+    // Values are checked against the schema as they are parsed, the first
+    // violation fails the parse with ParseErrorCode::schema_violation. With
+    // a projection only the values that are built are checked, required
+    // keys are checked either way. Must outlive the parser.
+    const Schema *schema = nullptr;
+
+    // Bytes the parsed tree may take, counted like Json::MemoryUsage as
+    // values are built. Going over fails the parse with
+    // ParseErrorCode::memory_limit, without reading the rest of the input,
+    // even if the excess is one long string or number.
+    // Interned strings are counted each time they are used.
+    size_t max_allocation = std::numeric_limits<size_t>::max();
+};
+
 class Parser {
   public:
-    Parser(std::istream &json_stream) : tokenizer(json_stream) {}
+    Parser(std::istream &json_stream, ParserOptions options = {})
+        : tokenizer(json_stream, options.lazy_numbers,
+                    options.max_allocation),
+          options(options) {}
+
+    // Starts over on another document. The tokenizer scratch buffer keeps
+    // its capacity, so parsing many documents with one Parser allocates
+    // only for the nodes it builds.
+    void Reset(std::istream &json_stream, ParserOptions options = {}) {
+        tokenizer.Reset(json_stream, options.lazy_numbers,
+                        options.max_allocation);
+        this->options = options;
+        allocated = 0;
+    }
 
     Json Parse();
 
+    // Same as Parse but reports malformed input through the return value
+    // instead of throwing.
+    Expected<Json> TryParse();
+
   private:
-    std::pair<std::string, Json> ParsePair();
+    friend class Query;
+
+    // projection is nullptr when the whole value is built, schema when it
+    // is not checked
+    Expected<Json> ParseValue(const Projection *projection = nullptr,
+                              const Schema *schema = nullptr);
+    Expected<Json> ParseChecked(const Projection *projection,
+                                const Schema &schema);
     Json ParseQuotedString();
     Json ParseNumber();
     Json ParseBool();
     Json ParseNull();
-    Json ParseObject();
-    Json ParseArray();
+    Expected<Json> ParseObject(const Projection *projection,
+                               const Schema *schema);
+    Expected<Json> ParseArray(const Projection *projection,
+                              const Schema *schema);
+    ParseError Error(ParseErrorCode code, const char *message,
+                     const Token &token) const;
+    // Counts json against options.max_allocation.
+    Expected<Json> Charge(Json json);
 
     Tokenizer tokenizer;
+    ParserOptions options;
+    size_t allocated = 0; // bytes of the tree built so far
+};
+
+// Per-thread free list of parsers for servers parsing many documents. A
+// lease hands out a parser reset to the given stream and returns it to the
+// calling thread's list when destroyed:
+//
+//   auto parser = ParserPool::Acquire(body);
+//   Json json = parser->Parse();
+class ParserPool {
+  public:
+    // Parsers kept per thread, more concurrent leases are simply freed.
+    static constexpr size_t max_idle = 8;
+
+    class Lease {
+      public:
+        Lease(Lease &&) = default;
+        Lease &operator=(Lease &&) = default;
+        ~Lease();
+
+        Parser &operator*() const { return *parser; }
+        Parser *operator->() const { return parser.get(); }
+
+      private:
+        friend class ParserPool;
+        explicit Lease(std::unique_ptr<Parser> parser)
+            : parser(std::move(parser)) {}
+
+        std::unique_ptr<Parser> parser;
+    };
+
+    static Lease Acquire(std::istream &json_stream, ParserOptions options = {});
 };
 } // namespace sjp
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+
+namespace sjp {
+class Parser;
+
+// Compiled path into a json document. Two syntaxes are accepted:
+//
+//   RFC 6901 pointers   "", "/users/0/name", "/a~1b" (~1 is '/', ~0 is '~')
+//   a JSONPath subset   "$", "$.users[0].name", "$['a b']", "$.users[*]",
+//                       "$.users[-1]", "$.users[1:3]", "$.config.*"
+//
+// Keys are matched against the escaped source form Json stores them in.
+class Query {
+  public:
+    static Query Compile(std::string_view expr);
+
+    // Every match in document order, aliasing into json.
+    std::vector<Json> Select(const Json &json) const;
+
+    // Runs the query straight over the token stream. Only matching values
+    // are built, everything else is skipped without allocating nodes.
+    std::vector<Json> Select(std::istream &json_stream) const;
+
+    std::optional<Json> SelectFirst(const Json &json) const;
+
+    // Stops reading the stream as soon as the first match is built.
+    std::optional<Json> SelectFirst(std::istream &json_stream) const;
+
+  private:
+    struct Step {
+        // member is a pointer token, a key for objects and an index for
+        // arrays when it is one
+        enum class Kind { member, key, index, wildcard, slice } kind{};
+        std::string key{};
+        int64_t index = -1;
+        std::optional<int64_t> start{};
+        std::optional<int64_t> end{};
+    };
+
+    std::vector<Step> steps;
+
+    static Query CompilePointer(std::string_view expr);
+    static Query CompilePath(std::string_view expr);
+
+    void Select(const Json &json, size_t first_step,
+                std::vector<Json> &out, bool first) const;
+    bool Stream(Parser &parser, size_t step, std::vector<Json> &out,
+                bool first) const;
+    static bool NeedsLength(const Step &step);
+};
+} // namespace sjp
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+namespace sjp {
+// A JSON Schema compiled for checking documents while they are parsed, see
+// ParserOptions::schema. The parse stops at the first violation, before the
+// rest of the document is read. Supported keywords:
+//
+//   type (including "integer"), enum, const, minimum, maximum,
+//   exclusiveMinimum, exclusiveMaximum, minLength, maxLength, properties,
+//   required, additionalProperties, items, minItems, maxItems
+//
+// Other keywords are ignored. Strings and keys are compared in the escaped
+// form Json stores them in.
+class Schema {
+  public:
+    static Schema Compile(const Json &schema);
+
+  private:
+    friend class Parser;
+
+    static constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+    // bit per JsonType
+    uint8_t types = 0xff;
+    bool integer = false; // numbers must be integral
+    std::vector<Json> enumeration;
+    bool has_enumeration = false;
+    std::optional<double> minimum;
+    std::optional<double> maximum;
+    std::optional<double> exclusive_minimum;
+    std::optional<double> exclusive_maximum;
+    size_t min_length = 0;
+    size_t max_length = unbounded;
+    size_t min_items = 0;
+    size_t max_items = unbounded;
+    // nullptr accepts any value
+    std::unordered_map<std::string, std::unique_ptr<Schema>> properties;
+    // each required key with its index, whether or not it is a property
+    std::unordered_map<std::string, size_t> required;
+    bool additional_allowed = true;
+    std::unique_ptr<Schema> additional;
+    std::unique_ptr<Schema> items;
+
+    // Each returns the violation message, nullptr if the value passes.
+    const char *CheckType(JsonType type) const;
+    // Everything but the type and the contents of containers.
+    const char *Check(const Json &json) const;
+    // An element of a packed array, bools are passed as 0 and 1.
+    const char *CheckPacked(JsonType type, double val) const;
+    const char *CheckNumber(double number) const;
+};
+} // namespace sjp
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "json.hpp"
+
+namespace sjp {
+// Binary snapshot of a parsed Json tree.
+//
+// The layout is a flat tape addressed by 32 bit offsets from the start of
+// the buffer, so a snapshot can be written to disk and mapped back without
+// any fixups:
+//
+//   header  "SJPS" | u16 version | u16 byte order mark | u64 size
+//   null    u8 tag
+//   bool    u8 tag (false/true)
+//   number  u8 tag | f64
+//   string  u8 tag | u32 len | bytes
+//   array   u8 tag | u32 count | u32 offset[count] | elements...
+//   object  u8 tag | u32 count | (u32 key, u32 value)[count] | entries...
+//
+// Object entries are sorted by key, keys are stored as u32 len | bytes.
+// Values are stored in host byte order, loading a snapshot written on a
+// machine of different endianness is rejected.
+class SnapshotView {
+  public:
+    JsonType Type() const;
+
+    size_t Size() const;
+
+    std::optional<SnapshotView> Get(size_t idx) const; // json-array
+
+    std::optional<SnapshotView> Get(std::string_view key) const; // json-object
+
+    template <typename RetType> std::optional<RetType> Get() const {
+        if constexpr (std::is_same_v<RetType, std::string_view>) {
+            return GetString();
+        } else if constexpr (std::is_same_v<RetType, std::string>) {
+            auto str = GetString();
+            return str ? std::optional<std::string>(*str) : std::nullopt;
+        } else if constexpr (std::is_same_v<RetType, bool>) {
+            return GetBool();
+        } else if constexpr (std::is_same_v<RetType, double>) {
+            return GetNumber();
+        } else if constexpr (std::is_same_v<RetType, int64_t>) {
+            auto number = GetNumber();
+            return number ? ToInt64(*number) : std::nullopt;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    // Rebuilds a regular Json tree from this node.
+    Json ToJson() const;
+
+  private:
+    friend class Snapshot;
+
+    SnapshotView(const char *data, size_t size, uint32_t offset)
+        : data(data), size(size), offset(offset) {}
+
+    const char *data;
+    size_t size;
+    uint32_t offset;
+
+    std::optional<std::string_view> GetString() const;
+    std::optional<double> GetNumber() const;
+    std::optional<bool> GetBool() const;
+};
+
+class Snapshot {
+  public:
+    constexpr static uint16_t version = 1;
+
+    // Serializes json into the snapshot format.
+    static std::string Write(const Json &json);
+
+    // Writes the snapshot of json to path.
+    static void Save(const Json &json, const std::string &path);
+
+    // Read-only copy of json for sharing between threads. The snapshot owns
+    // its bytes and views are plain pointers into them, so any number of
+    // threads can read it without locks or reference counting.
+    static Snapshot Freeze(const Json &json);
+
+    // Wraps an in-memory snapshot. The bytes must outlive the Snapshot and
+    // every view handed out by it.
+    static Snapshot Load(std::string_view bytes);
+
+    // Maps the snapshot stored at path read-only into memory.
+    static Snapshot Map(const std::string &path);
+
+    // Views borrow the snapshot bytes, they stay valid as long as any copy
+    // of the Snapshot they came from is alive.
+    SnapshotView Root() const;
+
+  private:
+    Snapshot(std::shared_ptr<const char> data, size_t size);
+
+    std::shared_ptr<const char> data;
+    size_t size;
+};
+} // namespace sjp
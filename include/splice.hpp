@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "json.hpp"
+
+namespace sjp {
+// Byte range of one value inside a serialized document.
+struct Span {
+    size_t begin;
+    size_t end; // one past the last byte
+};
+
+// Finds the value at an RFC 6901 pointer by scanning the bytes of json,
+// without building anything. Keys are matched against their escaped source
+// form. nullopt if the path does not resolve. Malformed input throws.
+std::optional<Span> Locate(std::string_view json, std::string_view pointer);
+
+// Returns json with the value at pointer replaced by value. If the last
+// token names a missing key of an existing object, or is "-" for an array,
+// the value is inserted there instead. Only the new value is serialized,
+// the bytes around it are copied unchanged, so the cost follows the size of
+// the edit rather than of the document:
+//
+//   std::string out = Splice(body, "/meta/trace_id", ToJson("abc"));
+//
+// Throws if the parent of the path does not resolve.
+std::string Splice(std::string_view json, std::string_view pointer,
+                   const Json &value);
+
+// Same, but removes the value and the separator next to it.
+std::string SpliceRemove(std::string_view json, std::string_view pointer);
+} // namespace sjp
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <streambuf>
+#include <string_view>
+
+namespace sjp {
+// Reads an in-memory document through std::istream without copying it.
+// The bytes must outlive the stream.
+//
+//   ViewStreamBuf buf(body);
+//   std::istream stream(&buf);
+//   Parser parser(stream);
+class ViewStreamBuf : public std::streambuf {
+  public:
+    ViewStreamBuf(std::string_view view) {
+        char *begin = const_cast<char *>(view.data());
+        setg(begin, begin, begin + view.size());
+    }
+};
+} // namespace sjp
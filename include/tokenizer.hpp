@@ -1,12 +1,11 @@
 #pragma once
 
+#include <istream>
+#include <limits>
 #include <string>
 #include <variant>
-#include <format>
 
-#define THROW_ERROR(msg)                                                       \
-    throw std::runtime_error(                                                  \
-        std::format("{} at {} in {}.", msg, __LINE__, __FILE__));
+#include "error.hpp"
 
 namespace sjp {
 enum class TokenType {
@@ -21,36 +20,106 @@ enum class TokenType {
     right_bracket, // ]
     comma,         // ,
     colon,         // :
-    end
+    end,
+    error // see Tokenizer::Error()
 };
 
 struct Token {
     TokenType type;
     std::variant<std::string, double, bool> value;
+    size_t offset = 0;
+    size_t line = 1;
+    size_t column = 1;
 };
 
+// The tokenizer never throws. Malformed input turns the current token into
+// TokenType::error, which sticks until the end, and the details are kept
+// in Error().
 class Tokenizer {
   public:
-    Tokenizer(std::istream &stream)
-        : token_stream(stream), token(TokenType::start, {}) {
+    // With raw_numbers, number tokens carry their checked but unconverted
+    // lexeme as a string instead of a double. A string or number longer
+    // than max_lexeme bytes fails with ParseErrorCode::memory_limit as soon
+    // as it gets there, before the rest of it is read.
+    Tokenizer(std::istream &stream, bool raw_numbers = false,
+              size_t max_lexeme = std::numeric_limits<size_t>::max())
+        : token_stream(&stream), token(TokenType::start, {}),
+          raw_numbers(raw_numbers), max_lexeme(max_lexeme) {
         Advance();
     }
 
+    // Starts over on a new stream, the scratch buffer keeps its capacity.
+    void Reset(std::istream &stream, bool raw_numbers = false,
+               size_t max_lexeme = std::numeric_limits<size_t>::max());
+
+    // Lowers the lexeme limit for the tokens read from now on.
+    void Limit(size_t bytes) { max_lexeme = bytes; }
+
     Token GetToken() {
-        Token rtoken = token;
+        // Advance overwrites the value, so it is moved out rather than
+        // copied
+        Token rtoken = std::move(token);
         Advance();
         return rtoken;
     }
 
-    Token PeekToken() const { return token; }
+    const Token &PeekToken() const { return token; }
+
+    const ParseError &Error() const { return error; }
+
+    // Skips the value starting at the current token without tokenizing its
+    // contents. Nested containers are matched on brackets and quotes only,
+    // the skipped bytes are not validated.
+    void SkipValue();
 
   private:
-    std::istream &token_stream;
+    std::istream *token_stream;
     Token token;
+    ParseError error{};
+    bool raw_numbers;
+    size_t max_lexeme;
+    std::string scratch; // lexeme being read
+    size_t offset = 0;
+    size_t line = 1;
+    size_t column = 1;
 
+    int Get();
+    void Fail(ParseErrorCode code, const char *message);
     void Advance();
     void ReadValue();
     void ReadQuotedString();
+    bool OverLimit();
     void SkipComments(bool);
 };
+
+// Helpers for readers that walk the tokens themselves and throw on
+// malformed input.
+namespace detail {
+// Reports a tokenizer error in preference to the generic message.
+[[noreturn]] inline void Fail(const Tokenizer &tokenizer, const char *message) {
+    if (tokenizer.PeekToken().type == TokenType::error) {
+        THROW_ERROR(tokenizer.Error().message);
+    }
+    THROW_ERROR(message);
+}
+
+inline Token Next(Tokenizer &tokenizer, TokenType type, const char *message) {
+    if (tokenizer.PeekToken().type != type) {
+        Fail(tokenizer, message);
+    }
+    return tokenizer.GetToken();
+}
+
+// Consumes the ',' between members or checks for the closing token.
+inline void Separator(Tokenizer &tokenizer, TokenType close) {
+    if (tokenizer.PeekToken().type == TokenType::comma) {
+        tokenizer.GetToken();
+        if (tokenizer.PeekToken().type == close) {
+            Fail(tokenizer, "Error parsing json - unexpected closing token");
+        }
+    } else if (tokenizer.PeekToken().type != close) {
+        Fail(tokenizer, "Error parsing json - expected ','");
+    }
+}
+} // namespace detail
 } // namespace sjp
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace sjp {
+enum class ValidationStatus {
+    ok,
+    unexpected_end,
+    unexpected_character,
+    trailing_characters,
+    invalid_literal,
+    invalid_number,
+    invalid_escape,
+    control_character,
+    invalid_utf8,
+    nesting_too_deep
+};
+
+struct ValidationResult {
+    ValidationStatus status;
+    size_t offset; // byte offset of the error, size of the input when ok
+
+    explicit operator bool() const { return status == ValidationStatus::ok; }
+};
+
+// Deepest nesting of objects and arrays Validate accepts.
+constexpr size_t max_validation_depth = 4096;
+
+// Checks that json is a single RFC 8259 json text and valid UTF-8 without
+// building anything and without allocating. This is stricter than Parser,
+// comments, raw control characters in strings and malformed escapes are
+// all rejected.
+ValidationResult Validate(std::string_view json);
+} // namespace sjp
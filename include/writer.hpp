@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cassert>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "json.hpp"
+
+namespace sjp {
+// Emits json straight into a byte buffer or a file descriptor without
+// building a tree. Calls must form a single well nested value, this is
+// only checked by assertions:
+//
+//   writer.StartObject().Key("ids").StartArray().Value(1).Value(2)
+//         .EndArray().EndObject();
+//
+// Keys and strings are plain text and get escaped, numbers are written in
+// their shortest round-trip form, non-finite doubles as null.
+class JsonWriter {
+  public:
+    enum class Style { compact, pretty };
+
+    // Appends to out.
+    explicit JsonWriter(std::string &out, Style style = Style::compact)
+        : out(&out), style(style) {}
+
+    // Buffers up to buffer_size bytes before each write(2) to fd. The fd is
+    // not closed.
+    explicit JsonWriter(int fd, Style style = Style::compact,
+                        size_t buffer_size = 64 * 1024)
+        : out(&buffer), style(style), fd(fd), buffer_size(buffer_size) {
+        buffer.reserve(buffer_size);
+    }
+
+    JsonWriter(const JsonWriter &) = delete;
+    JsonWriter &operator=(const JsonWriter &) = delete;
+
+    // Flushes what is left, errors are lost. Call Flush to see them.
+    ~JsonWriter();
+
+    JsonWriter &StartObject();
+    JsonWriter &EndObject();
+    JsonWriter &StartArray();
+    JsonWriter &EndArray();
+    JsonWriter &Key(std::string_view key);
+
+    JsonWriter &Value(std::string_view str);
+    JsonWriter &Value(const char *str) { return Value(std::string_view(str)); }
+    JsonWriter &Null();
+
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    JsonWriter &Value(T val) {
+        BeginValue();
+        if constexpr (std::is_same_v<T, bool>) {
+            out->append(val ? "true" : "false");
+        } else if constexpr (std::is_floating_point_v<T>) {
+            WriteNumber(static_cast<double>(val));
+        } else {
+            char buf[24];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), val);
+            out->append(buf, end);
+        }
+        EndValue();
+        return *this;
+    }
+
+    // Writes a whole tree, its strings are already escaped.
+    JsonWriter &Value(const Json &json);
+
+    // Writes the buffered bytes to the fd sink, throws on failure. No-op
+    // for a buffer sink.
+    void Flush();
+
+  private:
+    struct Scope {
+        bool object;
+        size_t count = 0;
+    };
+
+    std::string *out;
+    Style style;
+    int fd = -1;
+    size_t buffer_size = 0;
+    std::string buffer;
+    std::vector<Scope> scopes;
+    bool pending_key = false; // a key was written, its value comes next
+
+    void Indent();
+    void BeginValue();
+    void EndValue();
+    void Start(bool object);
+    void End(bool object);
+    void WriteKey(std::string_view key, bool escape);
+    void WriteNumber(double number);
+    void WriteTree(const Json &json);
+};
+} // namespace sjp
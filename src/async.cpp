@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "async.hpp"
+#include "error.hpp"
+#include "streams.hpp"
+
+namespace sjp {
+namespace {
+constexpr unsigned ring_entries = 256;
+
+ssize_t ReadNow(int fd, char *buf, size_t len) {
+    ssize_t n;
+    while ((n = read(fd, buf, len)) < 0 && errno == EINTR) {
+    }
+    return n < 0 ? -errno : n;
+}
+} // namespace
+
+// Minimal io_uring driven through the raw syscalls, only reads are issued.
+struct EventLoop::Ring {
+    int fd = -1;
+    void *sq_ptr = MAP_FAILED;
+    void *cq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    size_t cq_len = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqes_len = 0;
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_cqe *cqes;
+    unsigned sq_entries = 0;
+    unsigned to_submit = 0;
+
+    bool Setup() {
+        io_uring_params params{};
+        fd = static_cast<int>(
+            syscall(__NR_io_uring_setup, ring_entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+        sq_entries = params.sq_entries;
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        }
+        sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            return false;
+        }
+        cq_ptr = single ? sq_ptr
+                        : mmap(nullptr, cq_len, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, fd,
+                               IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            return false;
+        }
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(
+            mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto *sq = static_cast<char *>(sq_ptr);
+        sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        auto *cq = static_cast<char *>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_len);
+        }
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_len);
+        }
+        if (sq_ptr != MAP_FAILED) {
+            munmap(sq_ptr, sq_len);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int Enter(unsigned submit, unsigned wait) {
+        int ret;
+        do {
+            ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, submit,
+                                           wait,
+                                           wait ? IORING_ENTER_GETEVENTS : 0,
+                                           nullptr, 0));
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+
+    void Push(const ReadOp &op) {
+        unsigned tail = *sq_tail;
+        if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == sq_entries) {
+            // the submission queue is full, hand it to the kernel first
+            if (Enter(to_submit, 0) < 0) {
+                THROW_ERROR("Error submitting io_uring reads");
+            }
+            to_submit = 0;
+        }
+        unsigned idx = tail & *sq_mask;
+        io_uring_sqe &sqe = sqes[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = op.fd;
+        sqe.addr = reinterpret_cast<uintptr_t>(op.buf);
+        sqe.len = static_cast<uint32_t>(
+            std::min<size_t>(op.len, std::numeric_limits<uint32_t>::max()));
+        sqe.off = static_cast<uint64_t>(-1); // current file position
+        sqe.user_data = reinterpret_cast<uintptr_t>(&op);
+        sq_array[idx] = idx;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++to_submit;
+    }
+
+    // Submits queued reads, waits for at least one completion and collects
+    // every completed read.
+    void Reap(std::vector<ReadOp *> &done) {
+        if (Enter(to_submit, 1) < 0) {
+            THROW_ERROR("Error waiting for io_uring reads");
+        }
+        to_submit = 0;
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes[head & *cq_mask];
+            auto *op = reinterpret_cast<ReadOp *>(cqe.user_data);
+            op->result = cqe.res;
+            done.push_back(op);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
+
+EventLoop::EventLoop(Backend backend) {
+    if (backend != Backend::epoll) {
+        ring = std::make_unique<Ring>();
+        if (ring->Setup()) {
+            return;
+        }
+        ring.reset();
+        if (backend == Backend::io_uring) {
+            THROW_ERROR("io_uring is not available");
+        }
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        THROW_ERROR("Error creating epoll instance");
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+bool EventLoop::Submit(ReadOp &op) {
+    if (ring) {
+        ring->Push(op);
+        ++pending;
+        return true;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = &op;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, op.fd, &event) != 0 &&
+        (errno != ENOENT ||
+         epoll_ctl(epoll_fd, EPOLL_CTL_ADD, op.fd, &event) != 0)) {
+        if (errno != EPERM) {
+            op.result = -errno;
+            return false;
+        }
+        // regular files cannot be polled, they never block either
+        op.result = ReadNow(op.fd, op.buf, op.len);
+        return false;
+    }
+    ++pending;
+    return true;
+}
+
+void EventLoop::Forget(int fd) {
+    if (epoll_fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+void EventLoop::Run() {
+    std::vector<ReadOp *> done;
+    epoll_event events[64];
+    while (pending > 0) {
+        done.clear();
+        if (ring) {
+            ring->Reap(done);
+        } else {
+            int n = epoll_wait(epoll_fd, events, 64, -1);
+            if (n < 0 && errno != EINTR) {
+                THROW_ERROR("Error waiting for epoll events");
+            }
+            for (int i = 0; i < n; ++i) {
+                auto *op = static_cast<ReadOp *>(events[i].data.ptr);
+                op->result = ReadNow(op->fd, op->buf, op->len);
+                done.push_back(op);
+            }
+        }
+        pending -= done.size();
+        // resuming may queue new reads, done is not touched by them
+        for (auto *op : done) {
+            op->waiter.resume();
+        }
+    }
+}
+
+Task<Json> ParseAsync(EventLoop &loop, int fd, ParserOptions options) {
+    constexpr size_t chunk = 64 * 1024;
+    std::string buffer;
+    while (true) {
+        size_t size = buffer.size();
+        buffer.resize(size + chunk);
+        ssize_t n = co_await loop.Read(fd, buffer.data() + size, chunk);
+        buffer.resize(size + static_cast<size_t>(std::max<ssize_t>(n, 0)));
+        if (n == 0) {
+            break;
+        }
+        if (n < 0 && n != -EAGAIN && n != -EINTR) {
+            loop.Forget(fd);
+            THROW_ERROR("Error reading json");
+        }
+    }
+    loop.Forget(fd);
+
+    ViewStreamBuf buf(buffer);
+    std::istream stream(&buf);
+    auto parser = ParserPool::Acquire(stream, options);
+    co_return parser->Parse();
+}
+} // namespace sjp
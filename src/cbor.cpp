@@ -0,0 +1,339 @@
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "cbor.hpp"
+#include "error.hpp"
+#include "escape.hpp"
+
+namespace sjp::cbor {
+namespace {
+enum Major : uint8_t {
+    unsigned_int,
+    negative_int,
+    byte_string,
+    text_string,
+    array,
+    map,
+    tag,
+    simple
+};
+
+constexpr uint8_t indefinite = 31;
+constexpr uint8_t break_code = 0xFF;
+
+template <typename T> void PutBE(std::string &out, T val) {
+    for (int shift = static_cast<int>(sizeof(T) * 8) - 8; shift >= 0;
+         shift -= 8) {
+        out += static_cast<char>((val >> shift) & 0xFF);
+    }
+}
+
+void PutHead(std::string &out, Major major, uint64_t arg) {
+    auto head = static_cast<uint8_t>(major << 5);
+    if (arg < 24) {
+        out += static_cast<char>(head | arg);
+    } else if (arg <= UINT8_MAX) {
+        out += static_cast<char>(head | 24);
+        PutBE(out, static_cast<uint8_t>(arg));
+    } else if (arg <= UINT16_MAX) {
+        out += static_cast<char>(head | 25);
+        PutBE(out, static_cast<uint16_t>(arg));
+    } else if (arg <= UINT32_MAX) {
+        out += static_cast<char>(head | 26);
+        PutBE(out, static_cast<uint32_t>(arg));
+    } else {
+        out += static_cast<char>(head | 27);
+        PutBE(out, arg);
+    }
+}
+
+// Json strings hold the escaped source text, the wire carries plain text.
+void EncodeString(std::string_view str, std::string &out) {
+    std::string text;
+    if (str.find('\\') != std::string_view::npos) {
+        text = Unescape(str);
+        str = text;
+    }
+    PutHead(out, text_string, str.size());
+    out.append(str);
+}
+
+void EncodeNumber(double number, std::string &out) {
+    if (std::trunc(number) == number && number > -0x1p64 &&
+        number < 0x1p64) {
+        if (number >= 0) {
+            PutHead(out, unsigned_int, static_cast<uint64_t>(number));
+        } else {
+            PutHead(out, negative_int, static_cast<uint64_t>(-number) - 1);
+        }
+        return;
+    }
+    auto single = static_cast<float>(number);
+    if (static_cast<double>(single) == number) {
+        out += '\xFA';
+        PutBE(out, std::bit_cast<uint32_t>(single));
+    } else {
+        out += '\xFB';
+        PutBE(out, std::bit_cast<uint64_t>(number));
+    }
+}
+
+void EncodeValue(const Json &json, std::string &out) {
+    switch (json.type) {
+    case JsonType::jnull:
+        out += '\xF6';
+        break;
+    case JsonType::jbool:
+        out += json.Get<bool>().value() ? '\xF5' : '\xF4';
+        break;
+    case JsonType::jnumber:
+        EncodeNumber(json.Get<double>().value(), out);
+        break;
+    case JsonType::jstring:
+        EncodeString(static_cast<const JsonString &>(*json.value).value, out);
+        break;
+    case JsonType::jarray: {
+        const auto &arr = static_cast<const JsonArray &>(*json.value);
+        PutHead(out, array, arr.Size());
+        switch (arr.Packing()) {
+        case JsonArray::Storage::numbers:
+            for (double number : arr.Numbers()) {
+                EncodeNumber(number, out);
+            }
+            break;
+        case JsonArray::Storage::bools:
+            for (bool val : arr.Bools()) {
+                out += val ? '\xF5' : '\xF4';
+            }
+            break;
+        case JsonArray::Storage::generic:
+            for (auto &item : arr.Items()) {
+                EncodeValue(item, out);
+            }
+            break;
+        }
+    } break;
+    case JsonType::jobject: {
+        const auto &items =
+            static_cast<const JsonObject &>(*json.value).Items();
+        PutHead(out, map, items.size());
+        for (auto &[key, val] : items) {
+            EncodeString(key, out);
+            EncodeValue(val, out);
+        }
+    } break;
+    }
+}
+
+double HalfToDouble(uint16_t half) {
+    int exp = (half >> 10) & 0x1F;
+    int mant = half & 0x3FF;
+    double val;
+    if (exp == 0) {
+        val = std::ldexp(mant, -24);
+    } else if (exp != 31) {
+        val = std::ldexp(mant + 1024, exp - 25);
+    } else {
+        val = mant == 0 ? std::numeric_limits<double>::infinity()
+                        : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (half & 0x8000) ? -val : val;
+}
+
+class Decoder {
+  public:
+    Decoder(std::string_view bytes) : bytes(bytes) {}
+
+    Json DecodeValue();
+
+    bool AtEnd() const { return pos == bytes.size(); }
+
+  private:
+    std::string_view bytes;
+    size_t pos = 0;
+
+    std::string_view Take(uint64_t len) {
+        if (bytes.size() - pos < len) {
+            THROW_ERROR("Unexpected end of CBOR data");
+        }
+        auto view = bytes.substr(pos, static_cast<size_t>(len));
+        pos += static_cast<size_t>(len);
+        return view;
+    }
+
+    template <typename T> T ReadBE() {
+        T val = 0;
+        for (char c : Take(sizeof(T))) {
+            val = static_cast<T>((val << 8) | static_cast<uint8_t>(c));
+        }
+        return val;
+    }
+
+    bool AtBreak() {
+        if (pos == bytes.size()) {
+            THROW_ERROR("Unexpected end of CBOR data");
+        }
+        if (static_cast<uint8_t>(bytes[pos]) == break_code) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t ReadArg(uint8_t info);
+    std::string DecodeText(Major major, uint8_t info);
+    Json DecodeArray(uint8_t info);
+    Json DecodeMap(uint8_t info);
+};
+
+Json Number(double number) {
+    return Json{.type = JsonType::jnumber,
+                .value = std::make_shared<JsonNumber>(number)};
+}
+
+uint64_t Decoder::ReadArg(uint8_t info) {
+    switch (info) {
+    case 24:
+        return ReadBE<uint8_t>();
+    case 25:
+        return ReadBE<uint16_t>();
+    case 26:
+        return ReadBE<uint32_t>();
+    case 27:
+        return ReadBE<uint64_t>();
+    default: {
+        if (info < 24) {
+            return info;
+        }
+        THROW_ERROR("Invalid CBOR additional information");
+    }
+    }
+}
+
+std::string Decoder::DecodeText(Major major, uint8_t info) {
+    std::string text;
+    if (info != indefinite) {
+        AppendEscaped(text, Take(ReadArg(info)));
+        return text;
+    }
+    // indefinite strings are a sequence of definite chunks
+    while (!AtBreak()) {
+        auto head = ReadBE<uint8_t>();
+        if (head >> 5 != major || (head & 0x1F) == indefinite) {
+            THROW_ERROR("Invalid CBOR string chunk");
+        }
+        AppendEscaped(text, Take(ReadArg(head & 0x1F)));
+    }
+    return text;
+}
+
+Json Decoder::DecodeValue() {
+    auto head = ReadBE<uint8_t>();
+    auto major = static_cast<Major>(head >> 5);
+    auto info = static_cast<uint8_t>(head & 0x1F);
+    switch (major) {
+    case unsigned_int:
+        return Number(static_cast<double>(ReadArg(info)));
+    case negative_int:
+        return Number(-1.0 - static_cast<double>(ReadArg(info)));
+    case byte_string:
+    case text_string:
+        return Json{.type = JsonType::jstring,
+                    .value = std::make_shared<JsonString>(
+                        DecodeText(major, info))};
+    case array:
+        return DecodeArray(info);
+    case map:
+        return DecodeMap(info);
+    case tag:
+        ReadArg(info);
+        return DecodeValue();
+    case simple:
+        switch (info) {
+        case 20:
+        case 21:
+            return Json{.type = JsonType::jbool,
+                        .value = std::make_shared<JsonBool>(info == 21)};
+        case 22:
+        case 23:
+            return Json{.type = JsonType::jnull,
+                        .value = std::make_shared<JsonNull>(JNull{})};
+        case 25:
+            return Number(HalfToDouble(ReadBE<uint16_t>()));
+        case 26:
+            return Number(std::bit_cast<float>(ReadBE<uint32_t>()));
+        case 27:
+            return Number(std::bit_cast<double>(ReadBE<uint64_t>()));
+        default:
+            break;
+        }
+    }
+    THROW_ERROR("Unsupported CBOR data item");
+}
+
+Json Decoder::DecodeArray(uint8_t info) {
+    std::vector<Json> arr;
+    if (info == indefinite) {
+        while (!AtBreak()) {
+            arr.emplace_back(DecodeValue());
+        }
+    } else {
+        uint64_t size = ReadArg(info);
+        // every element takes at least one byte
+        arr.reserve(static_cast<size_t>(
+            std::min<uint64_t>(size, bytes.size() - pos)));
+        for (uint64_t i = 0; i < size; ++i) {
+            arr.emplace_back(DecodeValue());
+        }
+    }
+    return Json{.type = JsonType::jarray,
+                .value = std::make_shared<JsonArray>(std::move(arr))};
+}
+
+Json Decoder::DecodeMap(uint8_t info) {
+    std::unordered_map<std::string, Json> pairs;
+    uint64_t size = std::numeric_limits<uint64_t>::max();
+    if (info != indefinite) {
+        size = ReadArg(info);
+        pairs.reserve(static_cast<size_t>(
+            std::min<uint64_t>(size, bytes.size() - pos)));
+    }
+    for (uint64_t i = 0; i < size; ++i) {
+        if (info == indefinite && AtBreak()) {
+            break;
+        }
+        auto head = ReadBE<uint8_t>();
+        if (head >> 5 != text_string) {
+            THROW_ERROR("Error decoding CBOR map - invalid key");
+        }
+        auto key = DecodeText(text_string, head & 0x1F);
+        if (pairs.contains(key)) {
+            THROW_ERROR("Error duplicat key in CBOR map");
+        }
+        pairs.emplace(std::move(key), DecodeValue());
+    }
+    return Json{.type = JsonType::jobject,
+                .value = std::make_shared<JsonObject>(std::move(pairs))};
+}
+} // namespace
+
+void Encode(const Json &json, std::string &out) { EncodeValue(json, out); }
+
+std::string Encode(const Json &json) {
+    std::string out;
+    EncodeValue(json, out);
+    return out;
+}
+
+Json Decode(std::string_view bytes) {
+    Decoder decoder(bytes);
+    Json json = decoder.DecodeValue();
+    if (!decoder.AtEnd()) {
+        THROW_ERROR("Trailing bytes after CBOR data item");
+    }
+    return json;
+}
+} // namespace sjp::cbor
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <thread>
+
+#include "columnar.hpp"
+#include "error.hpp"
+#include "escape.hpp"
+#include "json.hpp"
+#include "streams.hpp"
+#include "tokenizer.hpp"
+
+namespace sjp {
+namespace {
+using detail::Fail;
+using detail::Next;
+using detail::Separator;
+
+uint32_t StringOffset(size_t size) {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        THROW_ERROR("String column exceeds 4GiB");
+    }
+    return static_cast<uint32_t>(size);
+}
+
+// Must be called before the row is counted in column.size.
+void SetValid(Column &column, bool valid) {
+    if (column.size % 8 == 0) {
+        column.validity.push_back(0);
+    }
+    if (valid) {
+        column.validity.back() |= static_cast<uint8_t>(1u << (column.size % 8));
+    }
+}
+
+void AppendNull(Column &column) {
+    SetValid(column, false);
+    switch (column.type) {
+    case ColumnType::number:
+        column.numbers.push_back(0);
+        break;
+    case ColumnType::int64:
+        column.integers.push_back(0);
+        break;
+    case ColumnType::boolean:
+        column.booleans.push_back(0);
+        break;
+    case ColumnType::string:
+        column.offsets.push_back(column.offsets.back());
+        break;
+    }
+    ++column.size;
+}
+
+[[noreturn]] void TypeMismatch(const Column &column) {
+    THROW_ERROR(std::format("Error extracting column {} - type mismatch",
+                            column.name));
+}
+
+// Number tokens keep their lexeme, see ExtractSlice.
+double Number(const std::string &lexeme) {
+    double number;
+    const char *end = lexeme.data() + lexeme.size();
+    auto [ptr, ec] = std::from_chars(lexeme.data(), end, number);
+    if (ec != std::errc()) {
+        THROW_ERROR("Error parsing json number - number out of range");
+    }
+    return number;
+}
+
+// Plain integers are read exactly. Other forms like 1e3 are accepted below
+// 2^53, where their double is exact, fractions and anything larger are not.
+std::optional<int64_t> Integer(const std::string &lexeme) {
+    int64_t val;
+    const char *end = lexeme.data() + lexeme.size();
+    auto [ptr, ec] = std::from_chars(lexeme.data(), end, val);
+    if (ec == std::errc() && ptr == end) {
+        return val;
+    }
+    double number;
+    if (ec == std::errc::result_out_of_range ||
+        std::from_chars(lexeme.data(), end, number).ec != std::errc() ||
+        std::abs(number) >= 0x1p53) {
+        return std::nullopt;
+    }
+    return ToInt64(number);
+}
+
+void AppendValue(Column &column, Tokenizer &tokenizer) {
+    switch (tokenizer.PeekToken().type) {
+    case TokenType::jnull:
+        tokenizer.GetToken();
+        AppendNull(column);
+        return;
+    case TokenType::quoted_str:
+    case TokenType::number:
+    case TokenType::jbool:
+        break;
+    case TokenType::left_braces:
+    case TokenType::left_bracket:
+        TypeMismatch(column);
+    default:
+        Fail(tokenizer, "Expected a json value");
+    }
+
+    Token token = tokenizer.GetToken();
+    switch (column.type) {
+    case ColumnType::number:
+        if (token.type != TokenType::number) {
+            TypeMismatch(column);
+        }
+        column.numbers.push_back(Number(std::get<std::string>(token.value)));
+        break;
+    case ColumnType::int64: {
+        if (token.type != TokenType::number) {
+            TypeMismatch(column);
+        }
+        auto val = Integer(std::get<std::string>(token.value));
+        if (!val) {
+            TypeMismatch(column);
+        }
+        column.integers.push_back(*val);
+    } break;
+    case ColumnType::boolean:
+        if (token.type != TokenType::jbool) {
+            TypeMismatch(column);
+        }
+        column.booleans.push_back(std::get<bool>(token.value));
+        break;
+    case ColumnType::string: {
+        if (token.type != TokenType::quoted_str) {
+            TypeMismatch(column);
+        }
+        const auto &str = std::get<std::string>(token.value);
+        if (str.find('\\') != std::string::npos) {
+            column.chars += Unescape(str);
+        } else {
+            column.chars += str;
+        }
+        column.offsets.push_back(StringOffset(column.chars.size()));
+    } break;
+    }
+    SetValid(column, true);
+    ++column.size;
+}
+
+Table MakeTable(const std::vector<ColumnSpec> &spec) {
+    Table table;
+    table.columns.reserve(spec.size());
+    for (auto &[name, type] : spec) {
+        Column column;
+        column.name = name;
+        column.type = type;
+        table.columns.push_back(std::move(column));
+    }
+    return table;
+}
+
+// Reads objects up to close, the opening bracket is already consumed.
+void ExtractRows(Tokenizer &tokenizer, TokenType close, Table &table) {
+    std::vector<bool> seen(table.columns.size());
+    while (tokenizer.PeekToken().type != close) {
+        Next(tokenizer, TokenType::left_braces,
+             "Error extracting columns - expected an object");
+        std::fill(seen.begin(), seen.end(), false);
+        while (tokenizer.PeekToken().type != TokenType::right_braces) {
+            Token key = Next(tokenizer, TokenType::quoted_str,
+                             "Error parsing json object - invalid key");
+            Next(tokenizer, TokenType::colon,
+                 "Error parsing json object - expected ':'");
+            auto it = std::find_if(
+                table.columns.begin(), table.columns.end(),
+                [&key](const Column &column) {
+                    return column.name == std::get<std::string>(key.value);
+                });
+            if (it == table.columns.end()) {
+                tokenizer.SkipValue();
+            } else {
+                auto idx = static_cast<size_t>(it - table.columns.begin());
+                if (seen[idx]) {
+                    THROW_ERROR("Error duplicat key in json object");
+                }
+                seen[idx] = true;
+                AppendValue(*it, tokenizer);
+            }
+            Separator(tokenizer, TokenType::right_braces);
+        }
+        tokenizer.GetToken();
+        for (size_t i = 0; i < seen.size(); ++i) {
+            if (!seen[i]) {
+                AppendNull(table.columns[i]);
+            }
+        }
+        ++table.rows;
+        Separator(tokenizer, close);
+    }
+}
+
+void ExtractSlice(std::string_view slice, bool allow_empty, Table &table) {
+    ViewStreamBuf buf(slice);
+    std::istream stream(&buf);
+    // raw numbers, so int64 columns are read from the digits
+    Tokenizer tokenizer(stream, true);
+    if (!allow_empty && tokenizer.PeekToken().type == TokenType::end) {
+        THROW_ERROR("Error extracting columns - expected an object");
+    }
+    ExtractRows(tokenizer, TokenType::end, table);
+}
+
+// Raw scan for the bounds of the top-level array. Up to parts - 1 commas
+// between its elements are picked as split points, spread evenly by bytes.
+// Only strings, comments and nesting are tracked, the slices are fully
+// checked by the tokenizer afterwards.
+std::vector<size_t> SplitPoints(std::string_view json, unsigned parts) {
+    size_t open = json.find_first_not_of(" \t\r\n");
+    if (open == std::string_view::npos || json[open] != '[') {
+        THROW_ERROR("Error extracting columns - expected an array");
+    }
+    std::vector<size_t> points{open};
+    size_t step = std::max<size_t>(json.size() / parts, 1);
+    size_t depth = 0;
+    size_t close = std::string_view::npos;
+    for (size_t pos = open;
+         pos < json.size() && close == std::string_view::npos; ++pos) {
+        switch (json[pos]) {
+        case '"':
+            for (++pos; pos < json.size() && json[pos] != '"'; ++pos) {
+                if (json[pos] == '\\') {
+                    ++pos;
+                }
+            }
+            break;
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            if (--depth == 0) {
+                close = pos;
+            }
+            break;
+        case ',':
+            if (depth == 1 && points.size() < parts &&
+                pos >= open + step * points.size()) {
+                points.push_back(pos);
+            }
+            break;
+        case '/':
+            if (pos + 1 < json.size() && json[pos + 1] == '/') {
+                pos = std::min(json.find('\n', pos), json.size());
+            } else if (pos + 1 < json.size() && json[pos + 1] == '*') {
+                pos = std::min(json.find("*/", pos + 2), json.size()) + 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (close == std::string_view::npos || json[close] != ']') {
+        THROW_ERROR("Error extracting columns - unterminated array");
+    }
+    if (json.find_first_not_of(" \t\r\n", close + 1) !=
+        std::string_view::npos) {
+        THROW_ERROR("Invalid JSON String");
+    }
+    points.push_back(close);
+    return points;
+}
+
+void Concat(Column &to, const Column &from) {
+    if (to.size % 8 == 0) {
+        to.validity.insert(to.validity.end(), from.validity.begin(),
+                           from.validity.end());
+        to.size += from.size;
+    } else {
+        for (size_t row = 0; row < from.size; ++row) {
+            SetValid(to, from.IsValid(row));
+            ++to.size;
+        }
+    }
+
+    to.numbers.insert(to.numbers.end(), from.numbers.begin(),
+                      from.numbers.end());
+    to.integers.insert(to.integers.end(), from.integers.begin(),
+                       from.integers.end());
+    to.booleans.insert(to.booleans.end(), from.booleans.begin(),
+                       from.booleans.end());
+    size_t base = to.chars.size();
+    to.chars += from.chars;
+    StringOffset(to.chars.size());
+    for (size_t row = 1; row < from.offsets.size(); ++row) {
+        to.offsets.push_back(static_cast<uint32_t>(base + from.offsets[row]));
+    }
+}
+} // namespace
+
+const Column *Table::Find(std::string_view name) const {
+    for (auto &column : columns) {
+        if (column.name == name) {
+            return &column;
+        }
+    }
+    return nullptr;
+}
+
+Table ExtractColumns(std::istream &json_stream,
+                     const std::vector<ColumnSpec> &spec) {
+    Tokenizer tokenizer(json_stream, true);
+    Table table = MakeTable(spec);
+    Next(tokenizer, TokenType::left_bracket,
+         "Error extracting columns - expected an array");
+    ExtractRows(tokenizer, TokenType::right_bracket, table);
+    tokenizer.GetToken();
+    Next(tokenizer, TokenType::end, "Invalid JSON String");
+    return table;
+}
+
+Table ExtractColumns(std::string_view json, const std::vector<ColumnSpec> &spec,
+                     unsigned threads) {
+    if (threads <= 1) {
+        ViewStreamBuf buf(json);
+        std::istream stream(&buf);
+        return ExtractColumns(stream, spec);
+    }
+
+    auto points = SplitPoints(json, threads);
+    size_t parts = points.size() - 1;
+    std::vector<Table> tables(parts, MakeTable(spec));
+    std::vector<std::exception_ptr> errors(parts);
+    auto extract = [&](size_t part) {
+        try {
+            auto slice = json.substr(points[part] + 1,
+                                     points[part + 1] - points[part] - 1);
+            ExtractSlice(slice, parts == 1, tables[part]);
+        } catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t part = 1; part < parts; ++part) {
+        workers.emplace_back(extract, part);
+    }
+    extract(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    Table table = std::move(tables[0]);
+    for (size_t part = 1; part < parts; ++part) {
+        for (size_t i = 0; i < table.columns.size(); ++i) {
+            Concat(table.columns[i], tables[part].columns[i]);
+        }
+        table.rows += tables[part].rows;
+    }
+    return table;
+}
+} // namespace sjp
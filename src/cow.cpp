@@ -0,0 +1,70 @@
+#include <stdexcept>
+
+#include "cow.hpp"
+#include "error.hpp"
+
+namespace sjp {
+static Json *Child(Json &json, const PathElement &step) {
+    if (auto *key = std::get_if<std::string>(&step.value)) {
+        if (json.type != JsonType::jobject) {
+            return nullptr;
+        }
+        return static_cast<JsonObject &>(*json.value).Find(*key);
+    }
+    if (json.type != JsonType::jarray) {
+        return nullptr;
+    }
+    return static_cast<JsonArray &>(*json.value)
+        .Find(std::get<size_t>(step.value));
+}
+
+// Makes sure json is the only owner of its node before it gets mutated.
+static void Detach(Json &json) {
+    if (json.value.use_count() > 1) {
+        json.value = json.value->Clone();
+    }
+}
+
+std::optional<const Json> CowJson::Get(const Path &path) const {
+    Json json = root;
+    for (auto &step : path) {
+        auto child = std::visit([&](auto &arg) { return json.Get(arg); },
+                                step.value);
+        if (!child) {
+            return std::nullopt;
+        }
+        json = std::move(*child);
+    }
+    return json;
+}
+
+void CowJson::Set(const Path &path, Json json) {
+    if (path.empty()) {
+        root = std::move(json);
+        return;
+    }
+
+    Json *node = &root;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        Detach(*node);
+        node = Child(*node, path[i]);
+        if (node == nullptr) {
+            THROW_ERROR("Error updating json - invalid path");
+        }
+    }
+    Detach(*node);
+
+    auto &last = path.back().value;
+    if (auto *key = std::get_if<std::string>(&last)) {
+        if (node->type != JsonType::jobject) {
+            THROW_ERROR("Error updating json - expected an object");
+        }
+        node->InsertOrUpdate(*key, std::move(json));
+    } else {
+        if (node->type != JsonType::jarray) {
+            THROW_ERROR("Error updating json - expected an array");
+        }
+        node->AppendOrUpdate(std::get<size_t>(last), std::move(json));
+    }
+}
+} // namespace sjp
@@ -0,0 +1,218 @@
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef SJP_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "decompress.hpp"
+#include "error.hpp"
+
+namespace sjp {
+// compressed bytes read per call
+static constexpr size_t input_size = 64 << 10;
+
+DecompressStreamBuf::DecompressStreamBuf(std::istream &compressed,
+                                         Codec codec, size_t chunk_size,
+                                         size_t chunks)
+    : compressed(compressed), codec(codec), ring(chunks) {
+    assert(chunk_size > 0 && chunks > 0);
+    for (auto &chunk : ring) {
+        chunk.data.resize(chunk_size);
+    }
+    producer = std::thread(&DecompressStreamBuf::Produce, this);
+}
+
+DecompressStreamBuf::~DecompressStreamBuf() {
+    // wakes the producer if it is waiting for a free chunk
+    stop.store(true, std::memory_order_relaxed);
+    tail.fetch_add(1, std::memory_order_release);
+    tail.notify_one();
+    producer.join();
+}
+
+DecompressStreamBuf::int_type DecompressStreamBuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    size_t next = tail.load(std::memory_order_relaxed);
+    if (reading) {
+        reading = false;
+        tail.store(++next, std::memory_order_release);
+        tail.notify_one();
+    }
+    while (head.load(std::memory_order_acquire) == next) {
+        head.wait(next, std::memory_order_acquire);
+    }
+    Chunk &chunk = ring[next % ring.size()];
+    if (chunk.size == 0) { // the end marker stays in place
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        return traits_type::eof();
+    }
+    reading = true;
+    setg(chunk.data.data(), chunk.data.data(),
+         chunk.data.data() + chunk.size);
+    return traits_type::to_int_type(*gptr());
+}
+
+DecompressStreamBuf::Chunk *DecompressStreamBuf::Acquire() {
+    size_t slot = head.load(std::memory_order_relaxed);
+    for (;;) {
+        size_t consumed = tail.load(std::memory_order_acquire);
+        if (stop.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        if (slot - consumed < ring.size()) {
+            return &ring[slot % ring.size()];
+        }
+        tail.wait(consumed, std::memory_order_acquire);
+    }
+}
+
+void DecompressStreamBuf::Publish(size_t size) {
+    size_t slot = head.load(std::memory_order_relaxed);
+    ring[slot % ring.size()].size = size;
+    head.store(slot + 1, std::memory_order_release);
+    head.notify_one();
+}
+
+bool DecompressStreamBuf::Fill(std::vector<char> &in) {
+    in.resize(input_size);
+    compressed.read(in.data(), static_cast<std::streamsize>(in.size()));
+    in.resize(static_cast<size_t>(compressed.gcount()));
+    return !in.empty();
+}
+
+void DecompressStreamBuf::Produce() {
+    std::vector<char> in;
+    try {
+        if (Fill(in)) {
+            bool zstd = in.size() >= 4 &&
+                        static_cast<unsigned char>(in[0]) == 0x28 &&
+                        static_cast<unsigned char>(in[1]) == 0xb5 &&
+                        static_cast<unsigned char>(in[2]) == 0x2f &&
+                        static_cast<unsigned char>(in[3]) == 0xfd;
+            if (codec == Codec::zstd ||
+                (codec == Codec::automatic && zstd)) {
+                DecompressZstd(in);
+            } else {
+                Inflate(in);
+            }
+        }
+    } catch (const std::exception &e) {
+        error = e.what();
+    }
+    if (Acquire()) {
+        Publish(0);
+    }
+}
+
+void DecompressStreamBuf::Inflate(std::vector<char> &in) {
+    z_stream stream{};
+    // 15 bit window, +32 detects gzip and zlib headers
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        THROW_ERROR("Failed to initialize zlib");
+    }
+    std::unique_ptr<z_stream, decltype(&inflateEnd)> guard(&stream,
+                                                           inflateEnd);
+    stream.next_in = reinterpret_cast<Bytef *>(in.data());
+    stream.avail_in = static_cast<uInt>(in.size());
+
+    Chunk *chunk = Acquire();
+    size_t used = 0;
+    bool ended = false;
+    bool pending = false; // output left over from a call that filled a chunk
+    while (chunk) {
+        if (stream.avail_in == 0 && !pending) {
+            if (!Fill(in)) {
+                break;
+            }
+            stream.next_in = reinterpret_cast<Bytef *>(in.data());
+            stream.avail_in = static_cast<uInt>(in.size());
+        }
+        if (used == chunk->data.size()) {
+            Publish(used);
+            chunk = Acquire();
+            used = 0;
+            continue;
+        }
+        stream.next_out = reinterpret_cast<Bytef *>(chunk->data.data() + used);
+        stream.avail_out = static_cast<uInt>(chunk->data.size() - used);
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        used = chunk->data.size() - stream.avail_out;
+        // a finished stream has flushed all of its output
+        pending = stream.avail_out == 0 && ret != Z_STREAM_END;
+        if (ret == Z_STREAM_END) {
+            // concatenated gzip members decode as one stream
+            ended = true;
+            inflateReset(&stream);
+        } else if (ret == Z_OK || ret == Z_BUF_ERROR) {
+            ended = false;
+        } else {
+            THROW_ERROR("Corrupt compressed stream");
+        }
+    }
+    if (!chunk) {
+        return;
+    }
+    if (!ended) {
+        THROW_ERROR("Truncated compressed stream");
+    }
+    if (used) {
+        Publish(used);
+    }
+}
+
+void DecompressStreamBuf::DecompressZstd(
+    [[maybe_unused]] std::vector<char> &in) {
+#ifdef SJP_WITH_ZSTD
+    std::unique_ptr<ZSTD_DStream, decltype(&ZSTD_freeDStream)> stream(
+        ZSTD_createDStream(), ZSTD_freeDStream);
+    if (!stream || ZSTD_isError(ZSTD_initDStream(stream.get()))) {
+        THROW_ERROR("Failed to initialize zstd");
+    }
+    ZSTD_inBuffer input{in.data(), in.size(), 0};
+
+    Chunk *chunk = Acquire();
+    size_t used = 0;
+    size_t ret = 0; // 0 once a frame is complete
+    bool pending = false;
+    while (chunk) {
+        if (input.pos == input.size && !pending) {
+            if (!Fill(in)) {
+                break;
+            }
+            input = {in.data(), in.size(), 0};
+        }
+        if (used == chunk->data.size()) {
+            Publish(used);
+            chunk = Acquire();
+            used = 0;
+            continue;
+        }
+        ZSTD_outBuffer output{chunk->data.data(), chunk->data.size(), used};
+        ret = ZSTD_decompressStream(stream.get(), &output, &input);
+        if (ZSTD_isError(ret)) {
+            THROW_ERROR(ZSTD_getErrorName(ret));
+        }
+        used = output.pos;
+        pending = output.pos == output.size && ret != 0;
+    }
+    if (!chunk) {
+        return;
+    }
+    if (ret != 0) {
+        THROW_ERROR("Truncated compressed stream");
+    }
+    if (used) {
+        Publish(used);
+    }
+#else
+    THROW_ERROR("zstd input needs the library built with SJP_WITH_ZSTD");
+#endif
+}
+} // namespace sjp
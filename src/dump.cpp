@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+
+namespace sjp {
+// Number of values in json, counting stops once limit is reached.
+static size_t Weight(const Json &json, size_t limit) {
+    size_t weight = 1;
+    if (json.type == JsonType::jarray) {
+        auto &array = static_cast<const JsonArray &>(*json.value);
+        if (array.Packing() != JsonArray::Storage::generic) {
+            return weight + array.Size();
+        }
+        for (auto &item : array.Items()) {
+            if (weight >= limit) {
+                break;
+            }
+            weight += Weight(item, limit - weight);
+        }
+    } else if (json.type == JsonType::jobject) {
+        auto &object = static_cast<const JsonObject &>(*json.value);
+        for (auto &[key, val] : object.Items()) {
+            if (weight >= limit) {
+                break;
+            }
+            weight += Weight(val, limit - weight);
+        }
+    }
+    return weight;
+}
+
+namespace {
+using Chunk = std::function<void(std::ostream &)>;
+
+// Cuts a tree into chunks that print to the same bytes as Dump when
+// concatenated in order. Containers of grain values or more are opened up,
+// runs of smaller children are grouped into chunks of about grain values.
+class Planner {
+  public:
+    explicit Planner(size_t grain) : grain(std::max<size_t>(grain, 1)) {}
+
+    std::vector<Chunk> chunks;
+
+    void Plan(const Json &json);
+
+  private:
+    size_t grain;
+
+    void Array(const JsonArray &array);
+    void Object(const JsonObject &object);
+};
+} // namespace
+
+void Planner::Plan(const Json &json) {
+    bool large = Weight(json, grain) >= grain;
+    if (large && json.type == JsonType::jarray) {
+        Array(static_cast<const JsonArray &>(*json.value));
+    } else if (large && json.type == JsonType::jobject) {
+        Object(static_cast<const JsonObject &>(*json.value));
+    } else {
+        chunks.push_back([&json](std::ostream &out) { json.Dump(out); });
+    }
+}
+
+void Planner::Array(const JsonArray &array) {
+    size_t size = array.Size();
+    size_t first = 0;
+    size_t weight = 0;
+    auto group = [&](size_t last) {
+        if (first < last) {
+            chunks.push_back([&array, first, last](std::ostream &out) {
+                array.PrintElements(out, first, last);
+            });
+        }
+        first = last;
+        weight = 0;
+    };
+    chunks.push_back([](std::ostream &out) { out << "["; });
+    if (array.Packing() != JsonArray::Storage::generic) {
+        while (first < size) {
+            group(std::min(first + grain, size));
+        }
+    } else {
+        auto &items = array.Items();
+        for (size_t i = 0; i < size; ++i) {
+            size_t item = Weight(items[i], grain);
+            if (item >= grain) {
+                group(i);
+                if (i) {
+                    chunks.push_back([](std::ostream &out) { out << ", "; });
+                }
+                Plan(items[i]);
+                first = i + 1;
+            } else if ((weight += item) >= grain) {
+                group(i + 1);
+            }
+        }
+        group(size);
+    }
+    chunks.push_back([](std::ostream &out) { out << "]"; });
+}
+
+void Planner::Object(const JsonObject &object) {
+    auto &items = object.Items();
+    auto first = items.begin();
+    size_t weight = 0;
+    auto group = [&](JsonObject::Member last) {
+        if (first != last) {
+            chunks.push_back([&object, first, last](std::ostream &out) {
+                object.PrintMembers(out, first, last);
+            });
+        }
+        first = last;
+        weight = 0;
+    };
+    chunks.push_back([](std::ostream &out) { out << "{"; });
+    for (auto i = items.begin(); i != items.end(); ++i) {
+        size_t member = Weight(i->second, grain);
+        if (member >= grain) {
+            group(i);
+            bool separator = i != items.begin();
+            chunks.push_back([i, separator](std::ostream &out) {
+                out << (separator ? ", " : "") << ESCAPE(i->first) << ": ";
+            });
+            Plan(i->second);
+            first = std::next(i);
+        } else if ((weight += member) >= grain) {
+            group(std::next(i));
+        }
+    }
+    group(items.end());
+    chunks.push_back([](std::ostream &out) { out << "}"; });
+}
+
+void Json::ParallelDump(std::ostream &out, unsigned threads,
+                        size_t grain) const {
+    if (threads <= 1) {
+        Dump(out);
+        return;
+    }
+    Planner planner(grain);
+    planner.Plan(*this);
+    auto &chunks = planner.chunks;
+
+    struct Rendered {
+        std::string text;
+        std::exception_ptr error;
+        std::atomic<bool> done = false;
+    };
+    std::vector<Rendered> rendered(chunks.size());
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> written = 0;
+    std::atomic<bool> stop = false;
+    // chunks rendered ahead of the writer, so a slow out bounds memory
+    size_t window = 2 * size_t{threads};
+    // Workers take the next chunk in order, so the ones the writer waits on
+    // are always rendered first.
+    auto work = [&] {
+        for (size_t i; !stop && (i = next++) < chunks.size();) {
+            for (size_t w; !stop && i >= (w = written) + window;) {
+                written.wait(w);
+            }
+            if (stop) {
+                break;
+            }
+            try {
+                std::ostringstream buf;
+                buf.copyfmt(out);
+                // only the first output of a dump is padded to out.width()
+                if (i) {
+                    buf.width(0);
+                }
+                chunks[i](buf);
+                rendered[i].text = std::move(buf).str();
+            } catch (...) {
+                rendered[i].error = std::current_exception();
+            }
+            rendered[i].done = true;
+            rendered[i].done.notify_one();
+        }
+    };
+    std::vector<std::thread> workers;
+    auto finish = [&] {
+        stop = true;
+        written = chunks.size();
+        written.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    };
+
+    try {
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back(work);
+        }
+        for (size_t i = 0; i < rendered.size(); ++i) {
+            auto &chunk = rendered[i];
+            chunk.done.wait(false);
+            if (chunk.error) {
+                std::rethrow_exception(chunk.error);
+            }
+            out.write(chunk.text.data(), chunk.text.size());
+            std::string().swap(chunk.text);
+            written = i + 1;
+            written.notify_all();
+        }
+    } catch (...) {
+        finish();
+        throw;
+    }
+    out.width(0);
+    finish();
+}
+} // namespace sjp
@@ -0,0 +1,175 @@
+#include <algorithm>
+
+#include "error.hpp"
+#include "escape.hpp"
+
+namespace sjp {
+static unsigned ReadHex4(std::string_view str, size_t pos) {
+    if (pos + 4 > str.size()) {
+        THROW_ERROR("Invalid unicode escape sequence");
+    }
+    unsigned code = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = str[i];
+        code <<= 4;
+        if (c >= '0' && c <= '9') {
+            code |= static_cast<unsigned>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            code |= static_cast<unsigned>(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            code |= static_cast<unsigned>(c - 'A' + 10);
+        } else {
+            THROW_ERROR("Invalid unicode escape sequence");
+        }
+    }
+    return code;
+}
+
+static void AppendUtf8(std::string &out, unsigned code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+std::string Unescape(std::string_view str) {
+    std::string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (str[i] != '\\') {
+            out += str[i];
+            continue;
+        }
+        if (++i == str.size()) {
+            THROW_ERROR("Invalid char after escape sequence");
+        }
+        switch (str[i]) {
+        case '"':
+        case '\\':
+        case '/':
+            out += str[i];
+            break;
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'u': {
+            unsigned code = ReadHex4(str, i + 1);
+            i += 4;
+            if (code >= 0xD800 && code < 0xDC00) {
+                // high surrogate, must be followed by a low one
+                if (i + 2 >= str.size() || str[i + 1] != '\\' ||
+                    str[i + 2] != 'u') {
+                    THROW_ERROR("Invalid unicode surrogate pair");
+                }
+                unsigned low = ReadHex4(str, i + 3);
+                if (low < 0xDC00 || low >= 0xE000) {
+                    THROW_ERROR("Invalid unicode surrogate pair");
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            } else if (code >= 0xDC00 && code < 0xE000) {
+                THROW_ERROR("Invalid unicode surrogate pair");
+            }
+            AppendUtf8(out, code);
+        } break;
+        default: {
+            THROW_ERROR("Invalid char after escape sequence");
+        }
+        }
+    }
+    return out;
+}
+
+void AppendEscaped(std::string &out, std::string_view str) {
+    static constexpr char hex[] = "0123456789abcdef";
+    size_t run = 0;
+    for (size_t i = 0; i < str.size(); ++i) {
+        auto c = static_cast<unsigned char>(str[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // copy the clean run in one go
+        out.append(str.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default: {
+            char seq[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out.append(seq, sizeof(seq));
+        }
+        }
+    }
+    out.append(str.data() + run, str.size() - run);
+}
+
+std::vector<std::string> PointerTokens(std::string_view pointer) {
+    if (!pointer.empty() && pointer[0] != '/') {
+        THROW_ERROR("Invalid JSON Pointer - expected '/'");
+    }
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < pointer.size()) {
+        size_t next = std::min(pointer.find('/', pos + 1), pointer.size());
+        std::string token;
+        for (size_t i = pos + 1; i < next; ++i) {
+            if (pointer[i] != '~') {
+                token += pointer[i];
+            } else if (i + 1 < next && pointer[i + 1] == '0') {
+                token += '~';
+                ++i;
+            } else if (i + 1 < next && pointer[i + 1] == '1') {
+                token += '/';
+                ++i;
+            } else {
+                THROW_ERROR("Invalid JSON Pointer - bad '~' escape");
+            }
+        }
+        tokens.push_back(std::move(token));
+        pos = next;
+    }
+    return tokens;
+}
+} // namespace sjp
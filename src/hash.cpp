@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <string_view>
+
+#include "json.hpp"
+
+namespace sjp {
+// splitmix64 finalizer
+static uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+static uint64_t HashNumber(double number) {
+    // -0 == 0, so both have to hash alike
+    return Mix(std::bit_cast<uint64_t>(number + 0.0) ^
+               static_cast<uint64_t>(JsonType::jnumber));
+}
+
+static uint64_t HashBool(bool val) {
+    return Mix((val ? 2 : 1) ^ static_cast<uint64_t>(JsonType::jbool) << 8);
+}
+
+static uint64_t HashString(std::string_view str) {
+    return Mix(std::hash<std::string_view>{}(str) ^
+               static_cast<uint64_t>(JsonType::jstring));
+}
+
+static const std::string &String(const Json &json) {
+    return static_cast<const JsonString &>(*json.value).value;
+}
+
+// Whether mutations below child reach parent, true for scalars.
+static bool Linked(const Json &child, const HashCache &parent) {
+    HashCache *cache = child.value->Cache();
+    return !cache || (cache->parent.load() == &parent && cache->hash.load());
+}
+
+// Links a container child under parent while hashing it. The parent may
+// only keep its hash if every such child is linked to it and cached, so
+// that mutations below reach it. Another parent may take the child over
+// while it is hashed, so the link is checked afterwards.
+static uint64_t HashChild(const Json &child, HashCache &parent,
+                          bool &cacheable) {
+    if (HashCache *cache = child.value->Cache()) {
+        parent.Adopt(*cache);
+    }
+    uint64_t hash = child.Hash();
+    if (!Linked(child, parent)) {
+        cacheable = false;
+    }
+    return hash;
+}
+
+static bool ChildrenLinked(const Json &json, const HashCache &cache) {
+    if (json.type == JsonType::jobject) {
+        return std::ranges::all_of(
+            static_cast<const JsonObject &>(*json.value).Items(),
+            [&](auto &item) { return Linked(item.second, cache); });
+    }
+    auto &array = static_cast<const JsonArray &>(*json.value);
+    return array.Packing() != JsonArray::Storage::generic ||
+           std::ranges::all_of(array.Items(), [&](const Json &item) {
+               return Linked(item, cache);
+           });
+}
+
+static uint64_t HashArray(const JsonArray &array, bool &cacheable) {
+    uint64_t hash = Mix(array.Size() ^ static_cast<uint64_t>(JsonType::jarray));
+    switch (array.Packing()) {
+    case JsonArray::Storage::numbers:
+        for (double number : array.Numbers()) {
+            hash = Mix(hash + HashNumber(number));
+        }
+        break;
+    case JsonArray::Storage::bools:
+        for (bool val : array.Bools()) {
+            hash = Mix(hash + HashBool(val));
+        }
+        break;
+    case JsonArray::Storage::generic:
+        for (auto &item : array.Items()) {
+            hash = Mix(hash + HashChild(item, *array.Cache(), cacheable));
+        }
+        break;
+    }
+    return hash;
+}
+
+static uint64_t HashObject(const JsonObject &object, bool &cacheable) {
+    // summed, so the iteration order of the map does not matter
+    uint64_t sum = 0;
+    for (auto &[key, val] : object.Items()) {
+        sum += Mix(HashString(key) ^
+                   Mix(HashChild(val, *object.Cache(), cacheable)));
+    }
+    return Mix(sum ^ Mix(object.Size() ^
+                         static_cast<uint64_t>(JsonType::jobject) << 8));
+}
+
+uint64_t Json::Hash() const {
+    switch (type) {
+    case JsonType::jnull:
+        return Mix(static_cast<uint64_t>(JsonType::jnull));
+    case JsonType::jbool:
+        return HashBool(*Get<bool>());
+    case JsonType::jnumber:
+        return HashNumber(*Get<double>());
+    case JsonType::jstring:
+        return HashString(String(*this));
+    case JsonType::jarray:
+    case JsonType::jobject:
+        break;
+    }
+    HashCache &cache = *value->Cache();
+    if (uint64_t hash = cache.hash.load()) {
+        return hash;
+    }
+    bool cacheable = true;
+    uint64_t hash =
+        type == JsonType::jarray
+            ? HashArray(static_cast<const JsonArray &>(*value), cacheable)
+            : HashObject(static_cast<const JsonObject &>(*value), cacheable);
+    hash += !hash; // 0 marks a hash not computed yet
+    if (cacheable) {
+        cache.hash.store(hash);
+        // a child unlinked or invalidated since it was hashed either saw
+        // this store and cleared it, or is seen here
+        if (!ChildrenLinked(*this, cache)) {
+            cache.Invalidate();
+        }
+    }
+    return hash;
+}
+
+// Element i of a possibly packed array, compared against a node.
+static bool ElementEquals(const JsonArray &array, size_t i, const Json &json) {
+    switch (array.Packing()) {
+    case JsonArray::Storage::numbers:
+        return json.type == JsonType::jnumber &&
+               *json.Get<double>() == array.Numbers()[i];
+    case JsonArray::Storage::bools:
+        return json.type == JsonType::jbool &&
+               *json.Get<bool>() == array.Bools()[i];
+    case JsonArray::Storage::generic:
+        break;
+    }
+    return array.Items()[i] == json;
+}
+
+static bool ArrayEquals(const JsonArray &lhs, const JsonArray &rhs) {
+    if (lhs.Packing() == rhs.Packing()) {
+        switch (lhs.Packing()) {
+        case JsonArray::Storage::numbers:
+            return std::ranges::equal(lhs.Numbers(), rhs.Numbers());
+        case JsonArray::Storage::bools:
+            return lhs.Bools() == rhs.Bools();
+        case JsonArray::Storage::generic:
+            break;
+        }
+    } else if (lhs.Packing() != JsonArray::Storage::generic &&
+               rhs.Packing() != JsonArray::Storage::generic) {
+        return false;
+    }
+    const JsonArray &generic =
+        rhs.Packing() == JsonArray::Storage::generic ? rhs : lhs;
+    const JsonArray &other = &generic == &rhs ? lhs : rhs;
+    for (size_t i = 0; i < generic.Size(); ++i) {
+        if (!ElementEquals(other, i, generic.Items()[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ObjectEquals(const JsonObject &lhs, const JsonObject &rhs) {
+    auto &items = rhs.Items();
+    for (auto &[key, val] : lhs.Items()) {
+        auto it = items.find(key);
+        if (it == items.end() || !(val == it->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Json::operator==(const Json &other) const {
+    if (type != other.type) {
+        return false;
+    }
+    if (value == other.value) {
+        return true;
+    }
+    switch (type) {
+    case JsonType::jnull:
+        return true;
+    case JsonType::jbool:
+        return *Get<bool>() == *other.Get<bool>();
+    case JsonType::jnumber:
+        return *Get<double>() == *other.Get<double>();
+    case JsonType::jstring:
+        return String(*this) == String(other);
+    case JsonType::jarray:
+    case JsonType::jobject:
+        break;
+    }
+    // cached after the first comparison, so unequal subtrees are usually
+    // rejected here without descending
+    if (Size() != other.Size() || Hash() != other.Hash()) {
+        return false;
+    }
+    if (type == JsonType::jarray) {
+        return ArrayEquals(static_cast<const JsonArray &>(*value),
+                           static_cast<const JsonArray &>(*other.value));
+    }
+    return ObjectEquals(static_cast<const JsonObject &>(*value),
+                        static_cast<const JsonObject &>(*other.value));
+}
+} // namespace sjp
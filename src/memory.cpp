@@ -0,0 +1,105 @@
+#include <climits>
+#include <unordered_set>
+
+#include "json.hpp"
+
+namespace sjp {
+// vtable pointer and the two reference counts
+static constexpr size_t control_block = sizeof(void *) + 2 * sizeof(int);
+
+// Short strings live inside the object, longer ones in a buffer of
+// capacity() + 1 bytes.
+static size_t Heap(const std::string &str) {
+    const char *data = str.data();
+    auto *self = reinterpret_cast<const char *>(&str);
+    bool inline_buffer = data >= self && data < self + sizeof(str);
+    return inline_buffer ? 0 : str.capacity() + 1;
+}
+
+// next pointer, the pair and the cached hash of the key
+static constexpr size_t member_node =
+    sizeof(void *) + sizeof(std::pair<const std::string, Json>) +
+    sizeof(size_t);
+
+size_t JsonObject::MemberMemory(const std::string &key) {
+    return member_node + Heap(key);
+}
+
+sjp::MemoryUsage Json::NodeMemoryUsage() const {
+    sjp::MemoryUsage usage;
+    usage.control_blocks = control_block;
+    switch (type) {
+    case JsonType::jstring: {
+        usage.nodes = sizeof(JsonString);
+        usage.strings = Heap(static_cast<const JsonString &>(*value).value);
+    } break;
+    case JsonType::jnumber:
+        if (auto *lazy = dynamic_cast<const JsonLazyNumber *>(value.get())) {
+            usage.nodes = sizeof(JsonLazyNumber);
+            usage.strings = Heap(lazy->Lexeme());
+        } else {
+            usage.nodes = sizeof(JsonNumber);
+        }
+        break;
+    case JsonType::jbool:
+        usage.nodes = sizeof(JsonBool);
+        break;
+    case JsonType::jnull:
+        usage.nodes = sizeof(JsonNull);
+        break;
+    case JsonType::jarray: {
+        auto &array = static_cast<const JsonArray &>(*value);
+        usage.nodes = sizeof(JsonArray);
+        switch (array.Packing()) {
+        case JsonArray::Storage::generic:
+            usage.arrays = array.Capacity() * sizeof(Json);
+            break;
+        case JsonArray::Storage::numbers:
+            usage.arrays = array.Capacity() * sizeof(double);
+            break;
+        case JsonArray::Storage::bools:
+            usage.arrays = array.Capacity() / CHAR_BIT;
+            break;
+        }
+    } break;
+    case JsonType::jobject: {
+        auto &items = static_cast<const JsonObject &>(*value).Items();
+        usage.nodes = sizeof(JsonObject);
+        usage.object_nodes = items.size() * member_node;
+        usage.buckets = items.bucket_count() * sizeof(void *);
+        for (auto &[key, val] : items) {
+            usage.strings += Heap(key);
+        }
+    } break;
+    }
+    return usage;
+}
+
+static void Count(const Json &json, std::unordered_set<const void *> &seen,
+                  sjp::MemoryUsage &usage) {
+    if (!seen.insert(json.value.get()).second) {
+        return;
+    }
+    usage += json.NodeMemoryUsage();
+    if (json.type == JsonType::jarray) {
+        auto &array = static_cast<const JsonArray &>(*json.value);
+        if (array.Packing() == JsonArray::Storage::generic) {
+            for (auto &item : array.Items()) {
+                Count(item, seen, usage);
+            }
+        }
+    } else if (json.type == JsonType::jobject) {
+        for (auto &[key, val] :
+             static_cast<const JsonObject &>(*json.value).Items()) {
+            Count(val, seen, usage);
+        }
+    }
+}
+
+sjp::MemoryUsage Json::MemoryUsage() const {
+    sjp::MemoryUsage usage;
+    std::unordered_set<const void *> seen;
+    Count(*this, seen, usage);
+    return usage;
+}
+} // namespace sjp
@@ -0,0 +1,331 @@
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include "error.hpp"
+#include "escape.hpp"
+#include "msgpack.hpp"
+
+namespace sjp::msgpack {
+namespace {
+template <typename T> void PutBE(std::string &out, T val) {
+    for (int shift = static_cast<int>(sizeof(T) * 8) - 8; shift >= 0;
+         shift -= 8) {
+        out += static_cast<char>((val >> shift) & 0xFF);
+    }
+}
+
+// Json strings hold the escaped source text, the wire carries plain text.
+void EncodeString(std::string_view str, std::string &out) {
+    std::string text;
+    if (str.find('\\') != std::string_view::npos) {
+        text = Unescape(str);
+        str = text;
+    }
+    if (str.size() < 32) {
+        out += static_cast<char>(0xA0 | str.size());
+    } else if (str.size() <= UINT8_MAX) {
+        out += '\xD9';
+        PutBE(out, static_cast<uint8_t>(str.size()));
+    } else if (str.size() <= UINT16_MAX) {
+        out += '\xDA';
+        PutBE(out, static_cast<uint16_t>(str.size()));
+    } else if (str.size() <= UINT32_MAX) {
+        out += '\xDB';
+        PutBE(out, static_cast<uint32_t>(str.size()));
+    } else {
+        THROW_ERROR("String too long for MessagePack");
+    }
+    out.append(str);
+}
+
+void EncodeNumber(double number, std::string &out) {
+    if (std::trunc(number) == number && number >= -0x1p63 &&
+        number < 0x1p64) {
+        if (number >= 0) {
+            auto val = static_cast<uint64_t>(number);
+            if (val < 0x80) {
+                out += static_cast<char>(val);
+            } else if (val <= UINT8_MAX) {
+                out += '\xCC';
+                PutBE(out, static_cast<uint8_t>(val));
+            } else if (val <= UINT16_MAX) {
+                out += '\xCD';
+                PutBE(out, static_cast<uint16_t>(val));
+            } else if (val <= UINT32_MAX) {
+                out += '\xCE';
+                PutBE(out, static_cast<uint32_t>(val));
+            } else {
+                out += '\xCF';
+                PutBE(out, val);
+            }
+        } else {
+            auto val = static_cast<int64_t>(number);
+            if (val >= -32) {
+                out += static_cast<char>(val);
+            } else if (val >= INT8_MIN) {
+                out += '\xD0';
+                PutBE(out, static_cast<uint8_t>(val));
+            } else if (val >= INT16_MIN) {
+                out += '\xD1';
+                PutBE(out, static_cast<uint16_t>(val));
+            } else if (val >= INT32_MIN) {
+                out += '\xD2';
+                PutBE(out, static_cast<uint32_t>(val));
+            } else {
+                out += '\xD3';
+                PutBE(out, static_cast<uint64_t>(val));
+            }
+        }
+        return;
+    }
+    auto single = static_cast<float>(number);
+    if (static_cast<double>(single) == number) {
+        out += '\xCA';
+        PutBE(out, std::bit_cast<uint32_t>(single));
+    } else {
+        out += '\xCB';
+        PutBE(out, std::bit_cast<uint64_t>(number));
+    }
+}
+
+void EncodeHeader(size_t size, char fix, char h16, char h32,
+                  std::string &out) {
+    if (size < 16) {
+        out += static_cast<char>(fix | static_cast<char>(size));
+    } else if (size <= UINT16_MAX) {
+        out += h16;
+        PutBE(out, static_cast<uint16_t>(size));
+    } else if (size <= UINT32_MAX) {
+        out += h32;
+        PutBE(out, static_cast<uint32_t>(size));
+    } else {
+        THROW_ERROR("Container too large for MessagePack");
+    }
+}
+
+void EncodeValue(const Json &json, std::string &out) {
+    switch (json.type) {
+    case JsonType::jnull:
+        out += '\xC0';
+        break;
+    case JsonType::jbool:
+        out += json.Get<bool>().value() ? '\xC3' : '\xC2';
+        break;
+    case JsonType::jnumber:
+        EncodeNumber(json.Get<double>().value(), out);
+        break;
+    case JsonType::jstring:
+        EncodeString(static_cast<const JsonString &>(*json.value).value, out);
+        break;
+    case JsonType::jarray: {
+        const auto &arr = static_cast<const JsonArray &>(*json.value);
+        EncodeHeader(arr.Size(), '\x90', '\xDC', '\xDD', out);
+        switch (arr.Packing()) {
+        case JsonArray::Storage::numbers:
+            for (double number : arr.Numbers()) {
+                EncodeNumber(number, out);
+            }
+            break;
+        case JsonArray::Storage::bools:
+            for (bool val : arr.Bools()) {
+                out += val ? '\xC3' : '\xC2';
+            }
+            break;
+        case JsonArray::Storage::generic:
+            for (auto &item : arr.Items()) {
+                EncodeValue(item, out);
+            }
+            break;
+        }
+    } break;
+    case JsonType::jobject: {
+        const auto &items =
+            static_cast<const JsonObject &>(*json.value).Items();
+        EncodeHeader(items.size(), '\x80', '\xDE', '\xDF', out);
+        for (auto &[key, val] : items) {
+            EncodeString(key, out);
+            EncodeValue(val, out);
+        }
+    } break;
+    }
+}
+
+class Decoder {
+  public:
+    Decoder(std::string_view bytes) : bytes(bytes) {}
+
+    Json DecodeValue();
+
+    bool AtEnd() const { return pos == bytes.size(); }
+
+  private:
+    std::string_view bytes;
+    size_t pos = 0;
+
+    std::string_view Take(size_t len) {
+        if (bytes.size() - pos < len) {
+            THROW_ERROR("Unexpected end of MessagePack data");
+        }
+        auto view = bytes.substr(pos, len);
+        pos += len;
+        return view;
+    }
+
+    template <typename T> T ReadBE() {
+        T val = 0;
+        for (char c : Take(sizeof(T))) {
+            val = static_cast<T>((val << 8) | static_cast<uint8_t>(c));
+        }
+        return val;
+    }
+
+    std::string DecodeText(size_t len) {
+        std::string text;
+        AppendEscaped(text, Take(len));
+        return text;
+    }
+
+    std::string DecodeKey();
+    Json DecodeArray(size_t size);
+    Json DecodeMap(size_t size);
+};
+
+Json Number(double number) {
+    return Json{.type = JsonType::jnumber,
+                .value = std::make_shared<JsonNumber>(number)};
+}
+
+Json String(std::string str) {
+    return Json{.type = JsonType::jstring,
+                .value = std::make_shared<JsonString>(std::move(str))};
+}
+
+Json Decoder::DecodeValue() {
+    auto tag = ReadBE<uint8_t>();
+    if (tag < 0x80) {
+        return Number(tag);
+    } else if (tag >= 0xE0) {
+        return Number(static_cast<int8_t>(tag));
+    } else if ((tag & 0xF0) == 0x80) {
+        return DecodeMap(tag & 0x0F);
+    } else if ((tag & 0xF0) == 0x90) {
+        return DecodeArray(tag & 0x0F);
+    } else if ((tag & 0xE0) == 0xA0) {
+        return String(DecodeText(tag & 0x1F));
+    }
+
+    switch (tag) {
+    case 0xC0:
+        return Json{.type = JsonType::jnull,
+                    .value = std::make_shared<JsonNull>(JNull{})};
+    case 0xC2:
+    case 0xC3:
+        return Json{.type = JsonType::jbool,
+                    .value = std::make_shared<JsonBool>(tag == 0xC3)};
+    case 0xC4:
+    case 0xD9:
+        return String(DecodeText(ReadBE<uint8_t>()));
+    case 0xC5:
+    case 0xDA:
+        return String(DecodeText(ReadBE<uint16_t>()));
+    case 0xC6:
+    case 0xDB:
+        return String(DecodeText(ReadBE<uint32_t>()));
+    case 0xCA:
+        return Number(std::bit_cast<float>(ReadBE<uint32_t>()));
+    case 0xCB:
+        return Number(std::bit_cast<double>(ReadBE<uint64_t>()));
+    case 0xCC:
+        return Number(ReadBE<uint8_t>());
+    case 0xCD:
+        return Number(ReadBE<uint16_t>());
+    case 0xCE:
+        return Number(ReadBE<uint32_t>());
+    case 0xCF:
+        return Number(static_cast<double>(ReadBE<uint64_t>()));
+    case 0xD0:
+        return Number(static_cast<int8_t>(ReadBE<uint8_t>()));
+    case 0xD1:
+        return Number(static_cast<int16_t>(ReadBE<uint16_t>()));
+    case 0xD2:
+        return Number(static_cast<int32_t>(ReadBE<uint32_t>()));
+    case 0xD3:
+        return Number(static_cast<double>(
+            static_cast<int64_t>(ReadBE<uint64_t>())));
+    case 0xDC:
+        return DecodeArray(ReadBE<uint16_t>());
+    case 0xDD:
+        return DecodeArray(ReadBE<uint32_t>());
+    case 0xDE:
+        return DecodeMap(ReadBE<uint16_t>());
+    case 0xDF:
+        return DecodeMap(ReadBE<uint32_t>());
+    default: {
+        THROW_ERROR("Unsupported MessagePack type");
+    }
+    }
+}
+
+std::string Decoder::DecodeKey() {
+    auto tag = ReadBE<uint8_t>();
+    if ((tag & 0xE0) == 0xA0) {
+        return DecodeText(tag & 0x1F);
+    }
+    switch (tag) {
+    case 0xD9:
+        return DecodeText(ReadBE<uint8_t>());
+    case 0xDA:
+        return DecodeText(ReadBE<uint16_t>());
+    case 0xDB:
+        return DecodeText(ReadBE<uint32_t>());
+    default: {
+        THROW_ERROR("Error decoding MessagePack map - invalid key");
+    }
+    }
+}
+
+Json Decoder::DecodeArray(size_t size) {
+    std::vector<Json> arr;
+    // every element takes at least one byte
+    arr.reserve(std::min(size, bytes.size() - pos));
+    for (size_t i = 0; i < size; ++i) {
+        arr.emplace_back(DecodeValue());
+    }
+    return Json{.type = JsonType::jarray,
+                .value = std::make_shared<JsonArray>(std::move(arr))};
+}
+
+Json Decoder::DecodeMap(size_t size) {
+    std::unordered_map<std::string, Json> pairs;
+    pairs.reserve(std::min(size, bytes.size() - pos));
+    for (size_t i = 0; i < size; ++i) {
+        auto key = DecodeKey();
+        if (pairs.contains(key)) {
+            THROW_ERROR("Error duplicat key in MessagePack map");
+        }
+        pairs.emplace(std::move(key), DecodeValue());
+    }
+    return Json{.type = JsonType::jobject,
+                .value = std::make_shared<JsonObject>(std::move(pairs))};
+}
+} // namespace
+
+void Encode(const Json &json, std::string &out) { EncodeValue(json, out); }
+
+std::string Encode(const Json &json) {
+    std::string out;
+    EncodeValue(json, out);
+    return out;
+}
+
+Json Decode(std::string_view bytes) {
+    Decoder decoder(bytes);
+    Json json = decoder.DecodeValue();
+    if (!decoder.AtEnd()) {
+        THROW_ERROR("Trailing bytes after MessagePack value");
+    }
+    return json;
+}
+} // namespace sjp::msgpack
@@ -1,58 +1,228 @@
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <memory>
 
+#include "escape.hpp"
 #include "json.hpp"
 #include "parser.hpp"
+#include "schema.hpp"
 #include "tokenizer.hpp"
 
 namespace sjp {
+void Projection::Add(std::string_view path) {
+    if (!path.empty() && path[0] != '/') {
+        THROW_ERROR("Invalid projection path - expected '/'");
+    }
+    Projection *node = this;
+    size_t pos = 0;
+    while (pos < path.size() && !node->leaf) {
+        size_t next = std::min(path.find('/', pos + 1), path.size());
+        std::string key;
+        for (size_t i = pos + 1; i < next; ++i) {
+            if (path[i] != '~') {
+                key += path[i];
+            } else if (i + 1 < next &&
+                       (path[i + 1] == '0' || path[i + 1] == '1')) {
+                key += path[++i] == '0' ? '~' : '/';
+            } else {
+                THROW_ERROR("Invalid projection path - invalid escape");
+            }
+        }
+        // keys are compared in the escaped form the tokenizer produces
+        std::string escaped;
+        AppendEscaped(escaped, key);
+        node = &node->children[std::move(escaped)];
+        pos = next;
+    }
+    // the whole subtree is kept, deeper paths are redundant
+    node->leaf = true;
+    node->children.clear();
+}
+
+namespace {
+thread_local std::vector<std::unique_ptr<Parser>> idle_parsers;
+} // namespace
+
+ParserPool::Lease::~Lease() {
+    if (parser && idle_parsers.size() < max_idle) {
+        idle_parsers.push_back(std::move(parser));
+    }
+}
+
+ParserPool::Lease ParserPool::Acquire(std::istream &json_stream,
+                                      ParserOptions options) {
+    if (idle_parsers.empty()) {
+        return Lease(std::make_unique<Parser>(json_stream, options));
+    }
+    auto parser = std::move(idle_parsers.back());
+    idle_parsers.pop_back();
+    parser->Reset(json_stream, options);
+    return Lease(std::move(parser));
+}
+
 Json Parser::Parse() {
-    Json json;
-    Token token = tokenizer.PeekToken();
-    switch (token.type) {
+    auto json = TryParse();
+    if (!json) {
+        auto &error = json.error();
+        THROW_ERROR(std::format("{} (line {}, column {})", error.message,
+                                error.line, error.column));
+    }
+    return std::move(*json);
+}
+
+Expected<Json> Parser::TryParse() {
+    allocated = 0;
+    tokenizer.Limit(options.max_allocation);
+    const Projection *projection = options.projection;
+    auto json = ParseValue(
+        projection && !projection->Leaf() ? projection : nullptr,
+        options.schema);
+    if (!json) {
+        return json;
+    }
+    Token token = tokenizer.GetToken();
+    if (token.type != TokenType::end) {
+        return Error(ParseErrorCode::unexpected_token, "Invalid JSON String",
+                     token);
+    }
+    return json;
+}
+
+// Tokenizer errors take precedence, they carry the more precise reason.
+ParseError Parser::Error(ParseErrorCode code, const char *message,
+                         const Token &token) const {
+    if (token.type == TokenType::error) {
+        return tokenizer.Error();
+    }
+    if (token.type == TokenType::end) {
+        code = ParseErrorCode::unexpected_end;
+    }
+    return {code, token.offset, token.line, token.column, message};
+}
+
+static ParseError Violation(const char *message, const Token &token) {
+    return {ParseErrorCode::schema_violation, token.offset, token.line,
+            token.column, message};
+}
+
+static ParseError MemoryLimit(const Token &token) {
+    return {ParseErrorCode::memory_limit, token.offset, token.line,
+            token.column, "Document exceeds the allocation limit"};
+}
+
+Expected<Json> Parser::Charge(Json json) {
+    if (options.max_allocation == std::numeric_limits<size_t>::max()) {
+        return json;
+    }
+    allocated += json.NodeMemoryUsage().Total();
+    if (allocated > options.max_allocation) {
+        return MemoryLimit(tokenizer.PeekToken());
+    }
+    // the next lexeme is read into scratch before it is charged
+    tokenizer.Limit(options.max_allocation - allocated);
+    return json;
+}
+
+Expected<Json> Parser::ParseValue(const Projection *projection,
+                                  const Schema *schema) {
+    if (schema) {
+        return ParseChecked(projection, *schema);
+    }
+    switch (tokenizer.PeekToken().type) {
+    case TokenType::quoted_str:
+        return Charge(ParseQuotedString());
+    case TokenType::number:
+        return Charge(ParseNumber());
+    case TokenType::jbool:
+        return Charge(ParseBool());
+    case TokenType::jnull:
+        return Charge(ParseNull());
+    case TokenType::left_braces:
+        return ParseObject(projection, nullptr);
+    case TokenType::left_bracket:
+        return ParseArray(projection, nullptr);
+    default:
+        return Error(ParseErrorCode::unexpected_token, "Invalid JSON String",
+                     tokenizer.PeekToken());
+    }
+}
+
+// The type is checked on the first token, before anything is built.
+// Containers check their elements as they go, the rest is checked once the
+// value is complete.
+Expected<Json> Parser::ParseChecked(const Projection *projection,
+                                    const Schema &schema) {
+    const Token &next = tokenizer.PeekToken();
+    ParseError violation = Violation(nullptr, next);
+    JsonType type;
+    switch (next.type) {
     case TokenType::quoted_str:
-        json = ParseQuotedString();
+        type = JsonType::jstring;
         break;
     case TokenType::number:
-        json = ParseNumber();
+        type = JsonType::jnumber;
         break;
     case TokenType::jbool:
-        json = ParseBool();
+        type = JsonType::jbool;
         break;
     case TokenType::jnull:
-        json = ParseNull();
+        type = JsonType::jnull;
         break;
     case TokenType::left_braces:
-        json = ParseObject();
+        type = JsonType::jobject;
         break;
     case TokenType::left_bracket:
-        json = ParseArray();
+        type = JsonType::jarray;
         break;
-    default: {
-        THROW_ERROR("Invalid JSON String");
+    default:
+        return ParseValue(projection);
     }
+    if ((violation.message = schema.CheckType(type))) {
+        return violation;
     }
-    token = tokenizer.GetToken();
-    if (token.type != TokenType::end) {
-        THROW_ERROR("Invalid JSON String");
+    auto json = type == JsonType::jobject  ? ParseObject(projection, &schema)
+                : type == JsonType::jarray ? ParseArray(projection, &schema)
+                                           : ParseValue(projection);
+    if (json && (violation.message = schema.Check(*json))) {
+        return violation;
     }
     return json;
 }
 
+std::shared_ptr<JsonString> StringTable::Intern(std::string str) {
+    if (str.size() > max_length) {
+        return std::make_shared<JsonString>(std::move(str));
+    }
+    if (auto it = nodes.find(str); it != nodes.end()) {
+        return it->second;
+    }
+    auto node = std::make_shared<JsonString>(std::move(str));
+    if (nodes.size() < max_entries) {
+        nodes.emplace(node->value, node);
+    }
+    return node;
+}
+
 Json Parser::ParseQuotedString() {
     Token token = tokenizer.GetToken();
-    if (token.type != TokenType::quoted_str) {
-        THROW_ERROR("Expected quoted string");
+    assert(token.type == TokenType::quoted_str);
+    auto &str = std::get<std::string>(token.value);
+    if (options.strings) {
+        return Json{.type = JsonType::jstring,
+                    .value = options.strings->Intern(std::move(str))};
     }
     return Json{.type = JsonType::jstring,
-                .value = std::make_shared<JsonString>(
-                    std::get<std::string>(token.value))};
+                .value = std::make_shared<JsonString>(std::move(str))};
 }
 
 Json Parser::ParseNumber() {
     Token token = tokenizer.GetToken();
-    if (token.type != TokenType::number) {
-        THROW_ERROR("Expected a number");
+    assert(token.type == TokenType::number);
+    if (auto *lexeme = std::get_if<std::string>(&token.value)) {
+        return Json{.type = JsonType::jnumber,
+                    .value = std::make_shared<JsonLazyNumber>(
+                        std::move(*lexeme))};
     }
     return Json{
         .type = JsonType::jnumber,
@@ -61,136 +231,211 @@ Json Parser::ParseNumber() {
 
 Json Parser::ParseBool() {
     Token token = tokenizer.GetToken();
-    if (token.type != TokenType::jbool) {
-        THROW_ERROR("Expected true|false");
-    }
+    assert(token.type == TokenType::jbool);
     return Json{.type = JsonType::jbool,
                 .value =
                     std::make_shared<JsonBool>(std::get<bool>(token.value))};
 }
 
 Json Parser::ParseNull() {
-    Token token = tokenizer.GetToken();
-    if (token.type != TokenType::jnull) {
-        THROW_ERROR("Expected null");
-    }
+    [[maybe_unused]] Token token = tokenizer.GetToken();
+    assert(token.type == TokenType::jnull);
     return Json{.type = JsonType::jnull,
                 .value = std::make_shared<JsonNull>(JNull{})};
 }
 
-std::pair<std::string, Json> Parser::ParsePair() {
-    if (tokenizer.PeekToken().type != TokenType::quoted_str) {
-        THROW_ERROR("Error parsing json object - invalid key");
-    }
-
-    Token token = tokenizer.GetToken();
-    auto key = std::get<std::string>(token.value);
-
-    if (tokenizer.GetToken().type != TokenType::colon) {
-        THROW_ERROR("Error parsing json object - expected ':'");
-    }
-
-    switch (tokenizer.PeekToken().type) {
-    case TokenType::quoted_str:
-        return {key, ParseQuotedString()};
-    case TokenType::number:
-        return {key, ParseNumber()};
-    case TokenType::jbool:
-        return {key, ParseBool()};
-    case TokenType::jnull:
-        return {key, ParseNull()};
-    case TokenType::left_braces:
-        return {key, ParseObject()};
-    case TokenType::left_bracket:
-        return {key, ParseArray()};
-    default: {
-        THROW_ERROR("Error parsing json object");
-    }
-    }
-}
-
-Json Parser::ParseObject() {
-    if (tokenizer.GetToken().type != TokenType::left_braces) {
-        THROW_ERROR("Error parsing json object - expected '{'");
-    }
+Expected<Json> Parser::ParseObject(const Projection *projection,
+                                   const Schema *schema) {
+    tokenizer.GetToken(); // '{'
     std::unordered_map<std::string, Json> pairs;
+    // required keys seen, each counted once even if repeated
+    std::vector<bool> seen(schema ? schema->required.size() : 0);
+    size_t required = 0;
+    size_t members = 0;  // bytes of the members besides their values
     // This is required to parse empty objects!
     while (tokenizer.PeekToken().type != TokenType::right_braces) {
-        auto [key, value] = ParsePair();
-        if (pairs.contains(key)) {
-            THROW_ERROR("Error duplicat key in json object");
+        Token token = tokenizer.GetToken();
+        if (token.type != TokenType::quoted_str) {
+            return Error(ParseErrorCode::unexpected_token,
+                         "Error parsing json object - invalid key", token);
+        }
+        auto key = std::get<std::string>(std::move(token.value));
+
+        Token colon = tokenizer.GetToken();
+        if (colon.type != TokenType::colon) {
+            return Error(ParseErrorCode::unexpected_token,
+                         "Error parsing json object - expected ':'", colon);
+        }
+
+        const Schema *child_schema = nullptr;
+        if (schema) {
+            if (auto it = schema->required.find(key);
+                it != schema->required.end() && !seen[it->second]) {
+                seen[it->second] = true;
+                ++required;
+            }
+            auto property = schema->properties.find(key);
+            if (property != schema->properties.end()) {
+                child_schema = property->second.get();
+            } else if (!schema->additional_allowed) {
+                return Violation("Key is not allowed by the schema", token);
+            } else {
+                child_schema = schema->additional.get();
+            }
+        }
+
+        const Projection *child = projection ? projection->Find(key) : nullptr;
+        if (projection && !child) {
+            // fields outside the projection are never built
+            tokenizer.SkipValue();
+        } else {
+            auto value = ParseValue(child && !child->Leaf() ? child : nullptr,
+                                    child_schema);
+            if (!value) {
+                return value;
+            }
+            if (pairs.contains(key)) {
+                return Error(ParseErrorCode::duplicate_key,
+                             "Error duplicat key in json object", token);
+            }
+            members += JsonObject::MemberMemory(key);
+            pairs.emplace(std::move(key), std::move(*value));
+            if (allocated + members + pairs.bucket_count() * sizeof(void *) >
+                options.max_allocation) {
+                return MemoryLimit(token);
+            }
         }
-        pairs.emplace(key, std::move(value));
 
         switch (tokenizer.PeekToken().type) {
         case TokenType::comma: {
             tokenizer.GetToken();
             if (tokenizer.PeekToken().type == TokenType::right_braces) {
-                THROW_ERROR("Error parsing json object - unexpected '}'");
+                return Error(ParseErrorCode::unexpected_token,
+                             "Error parsing json object - unexpected '}'",
+                             tokenizer.PeekToken());
             }
         } break;
         case TokenType::right_braces:
             break;
-        default: {
-            THROW_ERROR("Error parsing JSON object");
-        }
+        default:
+            return Error(ParseErrorCode::unexpected_token,
+                         "Error parsing JSON object", tokenizer.PeekToken());
         }
     }
-    if (tokenizer.GetToken().type != TokenType::right_braces) {
-        THROW_ERROR("Error parssing JSON object - expected '}'");
+    if (schema && required < schema->required.size()) {
+        return Violation("Object is missing a key the schema requires",
+                         tokenizer.PeekToken());
     }
-    return Json{.type = JsonType::jobject,
-                .value = std::make_shared<JsonObject>(std::move(pairs))};
+    tokenizer.GetToken(); // '}'
+    return Charge({.type = JsonType::jobject,
+                   .value = std::make_shared<JsonObject>(std::move(pairs))});
 }
 
-Json Parser::ParseArray() {
-    if (tokenizer.GetToken().type != TokenType::left_bracket) {
-        THROW_ERROR("Error parsing json arry - expected '['");
-    }
+// Arrays of only numbers or only bools are stored packed. Their elements
+// are taken straight from the tokens until a value of another type shows
+// up, at which point the array falls back to one node per element.
+Expected<Json> Parser::ParseArray(const Projection *projection,
+                                  const Schema *schema) {
+    tokenizer.GetToken(); // '['
+    const Schema *items = schema ? schema->items.get() : nullptr;
+    size_t size = 0;
+    TokenType packed = tokenizer.PeekToken().type;
+    bool generic = packed != TokenType::jbool &&
+                   (packed != TokenType::number || options.lazy_numbers);
+    std::vector<double> numbers;
+    std::vector<bool> bools;
     std::vector<Json> arr;
     // This is required to parse empty arrays!
     while (tokenizer.PeekToken().type != TokenType::right_bracket) {
-        switch (tokenizer.PeekToken().type) {
-        case TokenType::quoted_str:
-            arr.emplace_back(ParseQuotedString());
-            break;
-        case TokenType::number:
-            arr.emplace_back(ParseNumber());
-            break;
-        case TokenType::jbool: {
-            arr.emplace_back(ParseBool());
-        } break;
-        case TokenType::jnull: {
-            arr.emplace_back(ParseNull());
-        } break;
-        case TokenType::left_braces: {
-            arr.emplace_back(ParseObject());
-        } break;
-        case TokenType::left_bracket: {
-            arr.emplace_back(ParseArray());
-        } break;
-        default: {
-            THROW_ERROR("Error parsing JSON array");
+        if (schema && ++size > schema->max_items) {
+            return Violation("Array is longer than the schema allows",
+                             tokenizer.PeekToken());
         }
+        if (!generic && tokenizer.PeekToken().type == packed) {
+            Token token = tokenizer.GetToken();
+            const char *message = nullptr;
+            if (packed == TokenType::number) {
+                double val = std::get<double>(token.value);
+                numbers.push_back(val);
+                if (items) {
+                    message = items->CheckPacked(JsonType::jnumber, val);
+                }
+            } else {
+                bool val = std::get<bool>(token.value);
+                bools.push_back(val);
+                if (items) {
+                    message = items->CheckPacked(JsonType::jbool, val);
+                }
+            }
+            if (message) {
+                return Violation(message, token);
+            }
+            // packed elements are not nodes, so the array is counted as it
+            // grows, as are objects and generic arrays
+            if (allocated + numbers.capacity() * sizeof(double) +
+                    bools.capacity() / CHAR_BIT >
+                options.max_allocation) {
+                return MemoryLimit(token);
+            }
+        } else {
+            if (!generic) {
+                arr.reserve(numbers.size() + bools.size() + 1);
+                for (double val : numbers) {
+                    arr.push_back({.type = JsonType::jnumber,
+                                   .value = std::make_shared<JsonNumber>(val)});
+                }
+                for (bool val : bools) {
+                    arr.push_back({.type = JsonType::jbool,
+                                   .value = std::make_shared<JsonBool>(val)});
+                }
+                generic = true;
+                if (options.max_allocation !=
+                    std::numeric_limits<size_t>::max()) {
+                    for (auto &item : arr) {
+                        allocated += item.NodeMemoryUsage().Total();
+                    }
+                }
+            }
+            auto value = ParseValue(projection, items);
+            if (!value) {
+                return value;
+            }
+            arr.emplace_back(std::move(*value));
+            if (allocated + arr.capacity() * sizeof(Json) >
+                options.max_allocation) {
+                return MemoryLimit(tokenizer.PeekToken());
+            }
         }
+
         switch (tokenizer.PeekToken().type) {
         case TokenType::comma: {
             tokenizer.GetToken();
             if (tokenizer.PeekToken().type == TokenType::right_bracket) {
-                THROW_ERROR("Error parsing json object - unexpected ']'");
+                return Error(ParseErrorCode::unexpected_token,
+                             "Error parsing json object - unexpected ']'",
+                             tokenizer.PeekToken());
             }
         } break;
         case TokenType::right_bracket:
             break;
-        default: {
-            THROW_ERROR("Error parsing JSON array");
-        }
+        default:
+            return Error(ParseErrorCode::unexpected_token,
+                         "Error parsing JSON array", tokenizer.PeekToken());
         }
     }
-    if (tokenizer.GetToken().type != TokenType::right_bracket) {
-        THROW_ERROR("Error parssing JSON object - expected ']'");
+    if (schema && size < schema->min_items) {
+        return Violation("Array is shorter than the schema allows",
+                         tokenizer.PeekToken());
+    }
+    tokenizer.GetToken(); // ']'
+    std::shared_ptr<JsonArray> array;
+    if (generic) {
+        array = std::make_shared<JsonArray>(std::move(arr));
+    } else if (packed == TokenType::number) {
+        array = std::make_shared<JsonArray>(std::move(numbers));
+    } else {
+        array = std::make_shared<JsonArray>(std::move(bools));
     }
-    return Json{.type = JsonType::jarray,
-                .value = std::make_shared<JsonArray>(std::move(arr))};
+    return Charge({.type = JsonType::jarray, .value = std::move(array)});
 }
 } // namespace sjp
@@ -0,0 +1,323 @@
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+#include "escape.hpp"
+#include "json.hpp"
+
+namespace sjp {
+// Containers are cloned all the way down, so editing the copy in place never
+// reaches the original. Scalars are never mutated and stay shared.
+static Json DeepCopy(const Json &json) {
+    if (json.type == JsonType::jarray) {
+        auto &array = static_cast<const JsonArray &>(*json.value);
+        if (array.Packing() != JsonArray::Storage::generic) {
+            return {.type = JsonType::jarray, .value = array.Clone()};
+        }
+        std::vector<Json> items;
+        items.reserve(array.Size());
+        for (auto &item : array.Items()) {
+            items.push_back(DeepCopy(item));
+        }
+        return {.type = JsonType::jarray,
+                .value = std::make_shared<JsonArray>(std::move(items))};
+    }
+    if (json.type == JsonType::jobject) {
+        auto &object = static_cast<const JsonObject &>(*json.value);
+        std::unordered_map<std::string, Json> items;
+        items.reserve(object.Size());
+        for (auto &[key, val] : object.Items()) {
+            items.emplace(key, DeepCopy(val));
+        }
+        return {.type = JsonType::jobject,
+                .value = std::make_shared<JsonObject>(std::move(items))};
+    }
+    return json;
+}
+
+// "-" is one past the end, only valid where appending is.
+static size_t Index(const std::string &token, size_t size, bool append) {
+    if (append && token == "-") {
+        return size;
+    }
+    size_t idx = 0;
+    const char *end = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), end, idx);
+    if (token.empty() || ec != std::errc() || ptr != end ||
+        (token[0] == '0' && token.size() > 1)) {
+        THROW_ERROR("Invalid array index in JSON Pointer");
+    }
+    if (idx > size || (idx == size && !append)) {
+        THROW_ERROR("Array index out of range");
+    }
+    return idx;
+}
+
+namespace {
+// Applies the operations of one patch and remembers how to undo each of
+// them. Values displaced by an operation are moved into the log, not copied.
+class Transaction {
+  public:
+    explicit Transaction(Json &root) : root(root), saved(root) {}
+
+    void Apply(const Json &operation);
+    void Rollback();
+
+  private:
+    struct Undo {
+        Json container;
+        // the position, a key for objects and an index for arrays
+        std::string key;
+        size_t idx;
+        // restored at the position, or erased from it when nullopt
+        std::optional<Json> value;
+        // array elements after the position shift
+        bool shift;
+    };
+
+    Json &root;
+    Json saved; // restores the root if an operation replaced it
+    std::vector<Undo> log;
+
+    Json &Parent(const std::vector<std::string> &tokens);
+    Json Get(std::string_view path) const;
+    void Add(std::string_view path, Json value);
+    Json Remove(std::string_view path);
+    void Replace(std::string_view path, Json value);
+};
+} // namespace
+
+Json &Transaction::Parent(const std::vector<std::string> &tokens) {
+    Json *json = &root;
+    for (size_t i = 0; i + 1 < tokens.size(); ++i) {
+        Json *child = nullptr;
+        if (json->type == JsonType::jobject) {
+            child = static_cast<JsonObject &>(*json->value).Find(tokens[i]);
+        } else if (json->type == JsonType::jarray) {
+            auto &array = static_cast<JsonArray &>(*json->value);
+            child = array.Find(Index(tokens[i], array.Size(), false));
+        }
+        if (!child) {
+            THROW_ERROR("JSON Pointer does not resolve");
+        }
+        json = child;
+    }
+    return *json;
+}
+
+Json Transaction::Get(std::string_view path) const {
+    Json json = root;
+    for (auto &token : PointerTokens(path)) {
+        std::optional<Json> child;
+        if (json.type == JsonType::jobject) {
+            child = json.Get(token);
+        } else if (json.type == JsonType::jarray) {
+            child = json.Get(Index(token, json.Size(), false));
+        }
+        if (!child) {
+            THROW_ERROR("JSON Pointer does not resolve");
+        }
+        json = std::move(*child);
+    }
+    return json;
+}
+
+void Transaction::Add(std::string_view path, Json value) {
+    auto tokens = PointerTokens(path);
+    if (tokens.empty()) {
+        root = std::move(value);
+        return;
+    }
+    Json &parent = Parent(tokens);
+    auto &key = tokens.back();
+    if (parent.type == JsonType::jobject) {
+        auto &object = static_cast<JsonObject &>(*parent.value);
+        std::optional<Json> old;
+        if (Json *slot = object.Find(key)) {
+            old = std::exchange(*slot, std::move(value));
+        } else {
+            object.InsertOrUpdate(key, std::move(value));
+        }
+        log.push_back({parent, std::move(key), 0, std::move(old), false});
+    } else if (parent.type == JsonType::jarray) {
+        auto &array = static_cast<JsonArray &>(*parent.value);
+        size_t idx = Index(key, array.Size(), true);
+        array.Insert(idx, std::move(value));
+        log.push_back({parent, {}, idx, std::nullopt, true});
+    } else {
+        THROW_ERROR("JSON Pointer does not resolve");
+    }
+}
+
+Json Transaction::Remove(std::string_view path) {
+    auto tokens = PointerTokens(path);
+    if (tokens.empty()) {
+        THROW_ERROR("Cannot remove the document root");
+    }
+    Json &parent = Parent(tokens);
+    auto &key = tokens.back();
+    if (parent.type == JsonType::jobject) {
+        auto old = static_cast<JsonObject &>(*parent.value).Erase(key);
+        if (!old) {
+            THROW_ERROR("JSON Pointer does not resolve");
+        }
+        Json removed = *old;
+        log.push_back({parent, std::move(key), 0, std::move(old), false});
+        return removed;
+    }
+    if (parent.type != JsonType::jarray) {
+        THROW_ERROR("JSON Pointer does not resolve");
+    }
+    auto &array = static_cast<JsonArray &>(*parent.value);
+    size_t idx = Index(key, array.Size(), false);
+    Json removed = array.Erase(idx);
+    log.push_back({parent, {}, idx, removed, true});
+    return removed;
+}
+
+void Transaction::Replace(std::string_view path, Json value) {
+    auto tokens = PointerTokens(path);
+    if (tokens.empty()) {
+        root = std::move(value);
+        return;
+    }
+    Json &parent = Parent(tokens);
+    auto &key = tokens.back();
+    if (parent.type == JsonType::jobject) {
+        Json *slot = static_cast<JsonObject &>(*parent.value).Find(key);
+        if (!slot) {
+            THROW_ERROR("JSON Pointer does not resolve");
+        }
+        Json old = std::exchange(*slot, std::move(value));
+        log.push_back({parent, std::move(key), 0, std::move(old), false});
+    } else if (parent.type == JsonType::jarray) {
+        auto &array = static_cast<JsonArray &>(*parent.value);
+        size_t idx = Index(key, array.Size(), false);
+        // keeps a packed array packed when the types match
+        Json old = *parent.Get(idx);
+        array.AppendOrUpdate(idx, std::move(value));
+        log.push_back({parent, {}, idx, std::move(old), false});
+    } else {
+        THROW_ERROR("JSON Pointer does not resolve");
+    }
+}
+
+static const Json &Member(const Json &operation, const char *name) {
+    auto &items = static_cast<const JsonObject &>(*operation.value).Items();
+    auto it = items.find(name);
+    if (it == items.end()) {
+        THROW_ERROR(std::format("Invalid JSON Patch - missing \"{}\"", name));
+    }
+    return it->second;
+}
+
+static std::string Path(const Json &operation, const char *name) {
+    auto path = Member(operation, name).Get<std::string>();
+    if (!path) {
+        THROW_ERROR(std::format("Invalid JSON Patch - \"{}\" must be a string",
+                                name));
+    }
+    return std::move(*path);
+}
+
+void Transaction::Apply(const Json &operation) {
+    if (operation.type != JsonType::jobject) {
+        THROW_ERROR("Invalid JSON Patch - operations must be objects");
+    }
+    auto op = Member(operation, "op").Get<std::string>();
+    std::string path = Path(operation, "path");
+    if (op == "add") {
+        Add(path, DeepCopy(Member(operation, "value")));
+    } else if (op == "remove") {
+        Remove(path);
+    } else if (op == "replace") {
+        Replace(path, DeepCopy(Member(operation, "value")));
+    } else if (op == "move") {
+        std::string from = Path(operation, "from");
+        if (path.starts_with(from) && path.size() > from.size() &&
+            path[from.size()] == '/') {
+            THROW_ERROR("Cannot move a value into itself");
+        }
+        if (from != path) {
+            Add(path, Remove(from));
+        }
+    } else if (op == "copy") {
+        Add(path, DeepCopy(Get(Path(operation, "from"))));
+    } else if (op == "test") {
+        if (!(Get(path) == Member(operation, "value"))) {
+            THROW_ERROR("JSON Patch test failed");
+        }
+    } else {
+        THROW_ERROR("Invalid JSON Patch - unknown op");
+    }
+}
+
+void Transaction::Rollback() {
+    for (auto undo = log.rbegin(); undo != log.rend(); ++undo) {
+        Json &container = undo->container;
+        if (container.type == JsonType::jobject) {
+            auto &object = static_cast<JsonObject &>(*container.value);
+            if (undo->value) {
+                object.InsertOrUpdate(undo->key, std::move(*undo->value));
+            } else {
+                object.Erase(undo->key);
+            }
+            continue;
+        }
+        auto &array = static_cast<JsonArray &>(*container.value);
+        size_t idx = undo->idx;
+        if (!undo->shift) {
+            array.AppendOrUpdate(idx, std::move(*undo->value));
+        } else if (undo->value) {
+            array.Insert(idx, std::move(*undo->value));
+        } else {
+            array.Erase(idx);
+        }
+    }
+    log.clear();
+    root = saved;
+}
+
+void Json::ApplyPatch(const Json &patch) {
+    if (patch.type != JsonType::jarray) {
+        THROW_ERROR("Invalid JSON Patch - expected an array");
+    }
+    Transaction transaction(*this);
+    try {
+        for (size_t i = 0; i < patch.Size(); ++i) {
+            transaction.Apply(*patch.Get(i));
+        }
+    } catch (...) {
+        transaction.Rollback();
+        throw;
+    }
+}
+
+void Json::ApplyMergePatch(const Json &patch) {
+    if (patch.type != JsonType::jobject) {
+        *this = DeepCopy(patch);
+        return;
+    }
+    if (type != JsonType::jobject) {
+        *this = JsonBuilder<JsonType::jobject>();
+    }
+    auto &object = static_cast<JsonObject &>(*value);
+    for (auto &[key, val] : static_cast<const JsonObject &>(*patch.value)
+                                .Items()) {
+        if (val.type == JsonType::jnull) {
+            object.Erase(key);
+        } else if (Json *slot = object.Find(key)) {
+            slot->ApplyMergePatch(val);
+        } else {
+            Json child = JsonBuilder<JsonType::jnull>();
+            child.ApplyMergePatch(val);
+            object.InsertOrUpdate(key, std::move(child));
+        }
+    }
+}
+} // namespace sjp
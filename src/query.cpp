@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <charconv>
+#include <deque>
+
+#include "error.hpp"
+#include "escape.hpp"
+#include "parser.hpp"
+#include "query.hpp"
+
+namespace sjp {
+namespace {
+using detail::Next;
+using detail::Separator;
+
+std::optional<int64_t> ParseInt(std::string_view str) {
+    int64_t val;
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), val);
+    if (str.empty() || ec != std::errc() || ptr != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return val;
+}
+
+std::string EscapedKey(std::string_view key) {
+    std::string escaped;
+    AppendEscaped(escaped, key);
+    return escaped;
+}
+
+std::pair<int64_t, int64_t> SliceBounds(std::optional<int64_t> start,
+                                        std::optional<int64_t> end,
+                                        int64_t size) {
+    auto clamp = [size](int64_t idx) {
+        return std::clamp(idx < 0 ? idx + size : idx, int64_t{0}, size);
+    };
+    return {start ? clamp(*start) : 0, end ? clamp(*end) : size};
+}
+} // namespace
+
+Query Query::Compile(std::string_view expr) {
+    if (!expr.empty() && expr[0] == '$') {
+        return CompilePath(expr);
+    }
+    return CompilePointer(expr);
+}
+
+Query Query::CompilePointer(std::string_view expr) {
+    Query query;
+    if (expr.empty()) {
+        return query;
+    }
+    if (expr[0] != '/') {
+        THROW_ERROR("Invalid json pointer - expected '/'");
+    }
+    size_t pos = 1;
+    while (true) {
+        size_t next = expr.find('/', pos);
+        auto token = expr.substr(pos, next == std::string_view::npos
+                                          ? std::string_view::npos
+                                          : next - pos);
+        std::string key;
+        for (size_t i = 0; i < token.size(); ++i) {
+            if (token[i] != '~') {
+                key += token[i];
+                continue;
+            }
+            if (i + 1 == token.size() ||
+                (token[i + 1] != '0' && token[i + 1] != '1')) {
+                THROW_ERROR("Invalid json pointer - invalid escape");
+            }
+            key += token[++i] == '0' ? '~' : '/';
+        }
+
+        // array indices are plain digits without leading zeros
+        int64_t index = -1;
+        if (!key.empty() && (key == "0" || key[0] != '0') &&
+            std::all_of(key.begin(), key.end(),
+                        [](char c) { return c >= '0' && c <= '9'; })) {
+            index = ParseInt(key).value_or(-1);
+        }
+        query.steps.push_back({.kind = Step::Kind::member,
+                               .key = EscapedKey(key),
+                               .index = index});
+
+        if (next == std::string_view::npos) {
+            break;
+        }
+        pos = next + 1;
+    }
+    return query;
+}
+
+Query Query::CompilePath(std::string_view expr) {
+    Query query;
+    size_t pos = 1;
+    while (pos < expr.size()) {
+        if (expr[pos] == '.') {
+            ++pos;
+            if (pos < expr.size() && expr[pos] == '.') {
+                THROW_ERROR("Invalid json path - recursive descent is not "
+                            "supported");
+            }
+            if (pos < expr.size() && expr[pos] == '*') {
+                query.steps.push_back({.kind = Step::Kind::wildcard});
+                ++pos;
+                continue;
+            }
+            size_t end = std::min(expr.find_first_of(".[", pos), expr.size());
+            if (end == pos) {
+                THROW_ERROR("Invalid json path - empty member name");
+            }
+            query.steps.push_back(
+                {.kind = Step::Kind::key,
+                 .key = EscapedKey(expr.substr(pos, end - pos))});
+            pos = end;
+        } else if (expr[pos] == '[') {
+            ++pos;
+            if (pos < expr.size() && (expr[pos] == '\'' || expr[pos] == '"')) {
+                char quote = expr[pos++];
+                std::string name;
+                while (pos < expr.size() && expr[pos] != quote) {
+                    if (expr[pos] == '\\' && pos + 1 < expr.size()) {
+                        ++pos;
+                    }
+                    name += expr[pos++];
+                }
+                if (pos == expr.size()) {
+                    THROW_ERROR("Invalid json path - unterminated name");
+                }
+                ++pos;
+                query.steps.push_back(
+                    {.kind = Step::Kind::key, .key = EscapedKey(name)});
+            } else if (pos < expr.size() && expr[pos] == '*') {
+                ++pos;
+                query.steps.push_back({.kind = Step::Kind::wildcard});
+            } else {
+                size_t close = expr.find(']', pos);
+                if (close == std::string_view::npos) {
+                    THROW_ERROR("Invalid json path - expected ']'");
+                }
+                auto inner = expr.substr(pos, close - pos);
+                size_t colon = inner.find(':');
+                if (colon == std::string_view::npos) {
+                    auto index = ParseInt(inner);
+                    if (!index) {
+                        THROW_ERROR("Invalid json path - invalid index");
+                    }
+                    query.steps.push_back(
+                        {.kind = Step::Kind::index, .index = *index});
+                } else {
+                    Step step{.kind = Step::Kind::slice};
+                    auto start = inner.substr(0, colon);
+                    auto end = inner.substr(colon + 1);
+                    if (!start.empty() && !(step.start = ParseInt(start))) {
+                        THROW_ERROR("Invalid json path - invalid slice");
+                    }
+                    if (!end.empty() && !(step.end = ParseInt(end))) {
+                        THROW_ERROR("Invalid json path - invalid slice");
+                    }
+                    query.steps.push_back(std::move(step));
+                }
+                pos = close;
+            }
+            if (pos >= expr.size() || expr[pos] != ']') {
+                THROW_ERROR("Invalid json path - expected ']'");
+            }
+            ++pos;
+        } else {
+            THROW_ERROR("Invalid json path - expected '.' or '['");
+        }
+    }
+    return query;
+}
+
+std::vector<Json> Query::Select(const Json &json) const {
+    std::vector<Json> out;
+    Select(json, 0, out, false);
+    return out;
+}
+
+std::optional<Json> Query::SelectFirst(const Json &json) const {
+    std::vector<Json> out;
+    Select(json, 0, out, true);
+    return out.empty() ? std::nullopt : std::optional(std::move(out[0]));
+}
+
+// Walks the tree level by level on raw pointers, only the matches are
+// copied out.
+void Query::Select(const Json &json, size_t first_step, std::vector<Json> &out,
+                   bool first) const {
+    std::vector<const Json *> current{&json};
+    std::vector<const Json *> next;
+    std::deque<Json> scratch;
+    for (size_t i = first_step; i < steps.size() && !current.empty(); ++i) {
+        const Step &step = steps[i];
+        next.clear();
+        for (auto *node : current) {
+            if (node->type == JsonType::jobject) {
+                const auto &items =
+                    static_cast<const JsonObject &>(*node->value).Items();
+                if (step.kind == Step::Kind::member ||
+                    step.kind == Step::Kind::key) {
+                    auto it = items.find(step.key);
+                    if (it != items.end()) {
+                        next.push_back(&it->second);
+                    }
+                } else if (step.kind == Step::Kind::wildcard) {
+                    for (auto &[key, val] : items) {
+                        next.push_back(&val);
+                    }
+                }
+            } else if (node->type == JsonType::jarray) {
+                const auto &arr = static_cast<const JsonArray &>(*node->value);
+                auto size = static_cast<int64_t>(arr.Size());
+                int64_t begin = 0, end = 0;
+                switch (step.kind) {
+                case Step::Kind::member:
+                case Step::Kind::index:
+                    begin = step.index < 0 && step.kind == Step::Kind::index
+                                ? step.index + size
+                                : step.index;
+                    end = begin >= 0 ? begin + 1 : 0;
+                    break;
+                case Step::Kind::wildcard:
+                    end = size;
+                    break;
+                case Step::Kind::slice:
+                    std::tie(begin, end) =
+                        SliceBounds(step.start, step.end, size);
+                    break;
+                case Step::Kind::key:
+                    break;
+                }
+                for (int64_t idx = std::max(begin, int64_t{0});
+                     idx < std::min(end, size); ++idx) {
+                    auto i = static_cast<size_t>(idx);
+                    if (arr.Packing() == JsonArray::Storage::generic) {
+                        next.push_back(&arr.Items()[i]);
+                    } else {
+                        // packed elements have no node to point at
+                        scratch.push_back(*node->Get(i));
+                        next.push_back(&scratch.back());
+                    }
+                }
+            }
+        }
+        std::swap(current, next);
+    }
+    for (auto *node : current) {
+        out.push_back(*node);
+        if (first) {
+            return;
+        }
+    }
+}
+
+std::vector<Json> Query::Select(std::istream &json_stream) const {
+    Parser parser(json_stream);
+    std::vector<Json> out;
+    Stream(parser, 0, out, false);
+    Next(parser.tokenizer, TokenType::end, "Invalid JSON String");
+    return out;
+}
+
+std::optional<Json> Query::SelectFirst(std::istream &json_stream) const {
+    Parser parser(json_stream);
+    std::vector<Json> out;
+    if (Stream(parser, 0, out, true)) {
+        return std::move(out[0]);
+    }
+    Next(parser.tokenizer, TokenType::end, "Invalid JSON String");
+    return std::nullopt;
+}
+
+bool Query::NeedsLength(const Step &step) {
+    return (step.kind == Step::Kind::index && step.index < 0) ||
+           (step.kind == Step::Kind::slice &&
+            ((step.start && *step.start < 0) || (step.end && *step.end < 0)));
+}
+
+// Evaluates steps[i..] on the value at the current token. Returns true once
+// the first match is found when only the first one was asked for.
+bool Query::Stream(Parser &parser, size_t i, std::vector<Json> &out,
+                   bool first) const {
+    Tokenizer &tokenizer = parser.tokenizer;
+    if (i == steps.size()) {
+        auto json = parser.ParseValue();
+        if (!json) {
+            THROW_ERROR(json.error().message);
+        }
+        out.push_back(std::move(*json));
+        return first;
+    }
+
+    const Step &step = steps[i];
+    switch (tokenizer.PeekToken().type) {
+    case TokenType::left_braces: {
+        if (step.kind == Step::Kind::index || step.kind == Step::Kind::slice) {
+            break;
+        }
+        tokenizer.GetToken();
+        while (tokenizer.PeekToken().type != TokenType::right_braces) {
+            Token key = Next(tokenizer, TokenType::quoted_str,
+                             "Error parsing json object - invalid key");
+            Next(tokenizer, TokenType::colon,
+                 "Error parsing json object - expected ':'");
+            if (step.kind == Step::Kind::wildcard ||
+                std::get<std::string>(key.value) == step.key) {
+                if (Stream(parser, i + 1, out, first)) {
+                    return true;
+                }
+            } else {
+                tokenizer.SkipValue();
+            }
+            Separator(tokenizer, TokenType::right_braces);
+        }
+        tokenizer.GetToken();
+        return false;
+    }
+    case TokenType::left_bracket: {
+        if (step.kind == Step::Kind::key) {
+            break;
+        }
+        if (NeedsLength(step)) {
+            // positions counted from the end need the whole array
+            auto json = parser.ParseValue();
+            if (!json) {
+                THROW_ERROR(json.error().message);
+            }
+            size_t before = out.size();
+            Select(*json, i, out, first);
+            return first && out.size() > before;
+        }
+        tokenizer.GetToken();
+        for (int64_t idx = 0;
+             tokenizer.PeekToken().type != TokenType::right_bracket; ++idx) {
+            bool match = false;
+            switch (step.kind) {
+            case Step::Kind::member:
+            case Step::Kind::index:
+                match = idx == step.index;
+                break;
+            case Step::Kind::wildcard:
+                match = true;
+                break;
+            case Step::Kind::slice:
+                match = (!step.start || idx >= *step.start) &&
+                        (!step.end || idx < *step.end);
+                break;
+            case Step::Kind::key:
+                break;
+            }
+            if (match) {
+                if (Stream(parser, i + 1, out, first)) {
+                    return true;
+                }
+            } else {
+                tokenizer.SkipValue();
+            }
+            Separator(tokenizer, TokenType::right_bracket);
+        }
+        tokenizer.GetToken();
+        return false;
+    }
+    default:
+        break;
+    }
+    tokenizer.SkipValue();
+    return false;
+}
+} // namespace sjp
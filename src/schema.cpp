@@ -0,0 +1,224 @@
+#include <cmath>
+
+#include "error.hpp"
+#include "escape.hpp"
+#include "schema.hpp"
+
+namespace sjp {
+static uint8_t Bit(JsonType type) {
+    return static_cast<uint8_t>(1u << static_cast<unsigned>(type));
+}
+
+static double Number(const Json &json, const char *keyword) {
+    if (json.type != JsonType::jnumber) {
+        THROW_ERROR(std::format("Invalid schema - {} must be a number",
+                                keyword));
+    }
+    return *json.Get<double>();
+}
+
+static size_t Count(const Json &json, const char *keyword) {
+    auto count = json.type == JsonType::jnumber ? json.Get<int64_t>()
+                                                : std::nullopt;
+    if (!count || *count < 0) {
+        THROW_ERROR(std::format(
+            "Invalid schema - {} must be a non-negative integer", keyword));
+    }
+    return static_cast<size_t>(*count);
+}
+
+// Subschemas may also be true (anything) or false (nothing).
+static std::unique_ptr<Schema> Subschema(const Json &json) {
+    return std::make_unique<Schema>(Schema::Compile(json));
+}
+
+Schema Schema::Compile(const Json &json) {
+    Schema schema;
+    if (json.type == JsonType::jbool) {
+        schema.types = *json.Get<bool>() ? 0xff : 0;
+        return schema;
+    }
+    if (json.type != JsonType::jobject) {
+        THROW_ERROR("Invalid schema - expected an object");
+    }
+    auto &keywords = static_cast<const JsonObject &>(*json.value).Items();
+    for (auto &[keyword, val] : keywords) {
+        if (keyword == "type") {
+            std::vector<Json> names;
+            if (val.type == JsonType::jarray) {
+                for (size_t i = 0; i < val.Size(); ++i) {
+                    names.push_back(*val.Get(i));
+                }
+            } else {
+                names.push_back(val);
+            }
+            bool number = false;
+            schema.types = 0;
+            for (auto &name : names) {
+                auto type = name.Get<std::string>();
+                if (type == "null") {
+                    schema.types |= Bit(JsonType::jnull);
+                } else if (type == "boolean") {
+                    schema.types |= Bit(JsonType::jbool);
+                } else if (type == "number") {
+                    schema.types |= Bit(JsonType::jnumber);
+                    number = true;
+                } else if (type == "integer") {
+                    schema.types |= Bit(JsonType::jnumber);
+                    schema.integer = true;
+                } else if (type == "string") {
+                    schema.types |= Bit(JsonType::jstring);
+                } else if (type == "array") {
+                    schema.types |= Bit(JsonType::jarray);
+                } else if (type == "object") {
+                    schema.types |= Bit(JsonType::jobject);
+                } else {
+                    THROW_ERROR("Invalid schema - unknown type");
+                }
+            }
+            schema.integer = schema.integer && !number;
+        } else if (keyword == "enum" || keyword == "const") {
+            if (keyword == "enum" && val.type != JsonType::jarray) {
+                THROW_ERROR("Invalid schema - enum must be an array");
+            }
+            if (keyword == "const") {
+                schema.enumeration = {val};
+            } else {
+                for (size_t i = 0; i < val.Size(); ++i) {
+                    schema.enumeration.push_back(*val.Get(i));
+                }
+            }
+            schema.has_enumeration = true;
+        } else if (keyword == "minimum") {
+            schema.minimum = Number(val, "minimum");
+        } else if (keyword == "maximum") {
+            schema.maximum = Number(val, "maximum");
+        } else if (keyword == "exclusiveMinimum") {
+            schema.exclusive_minimum = Number(val, "exclusiveMinimum");
+        } else if (keyword == "exclusiveMaximum") {
+            schema.exclusive_maximum = Number(val, "exclusiveMaximum");
+        } else if (keyword == "minLength") {
+            schema.min_length = Count(val, "minLength");
+        } else if (keyword == "maxLength") {
+            schema.max_length = Count(val, "maxLength");
+        } else if (keyword == "minItems") {
+            schema.min_items = Count(val, "minItems");
+        } else if (keyword == "maxItems") {
+            schema.max_items = Count(val, "maxItems");
+        } else if (keyword == "items") {
+            schema.items = Subschema(val);
+        } else if (keyword == "additionalProperties") {
+            if (val.type == JsonType::jbool) {
+                schema.additional_allowed = *val.Get<bool>();
+            } else {
+                schema.additional = Subschema(val);
+            }
+        } else if (keyword == "properties") {
+            if (val.type != JsonType::jobject) {
+                THROW_ERROR("Invalid schema - properties must be an object");
+            }
+            for (auto &[key, property] :
+                 static_cast<const JsonObject &>(*val.value).Items()) {
+                schema.properties[key] = Subschema(property);
+            }
+        }
+    }
+    if (auto required = json.Get("required")) {
+        if (required->type != JsonType::jarray) {
+            THROW_ERROR("Invalid schema - required must be an array");
+        }
+        for (size_t i = 0; i < required->Size(); ++i) {
+            auto key = required->Get(i)->Get<std::string>();
+            if (!key) {
+                THROW_ERROR("Invalid schema - required keys must be strings");
+            }
+            size_t index = schema.required.size();
+            schema.required.emplace(std::move(*key), index);
+        }
+    }
+    return schema;
+}
+
+const char *Schema::CheckType(JsonType type) const {
+    return types & Bit(type) ? nullptr : "Value has a type the schema forbids";
+}
+
+const char *Schema::CheckNumber(double number) const {
+    if (integer && std::trunc(number) != number) {
+        return "Number is not an integer";
+    }
+    if ((minimum && number < *minimum) ||
+        (exclusive_minimum && number <= *exclusive_minimum)) {
+        return "Number is below the schema minimum";
+    }
+    if ((maximum && number > *maximum) ||
+        (exclusive_maximum && number >= *exclusive_maximum)) {
+        return "Number is above the schema maximum";
+    }
+    return nullptr;
+}
+
+// In code points, after decoding escapes.
+static size_t Length(const std::string &escaped) {
+    std::string decoded;
+    std::string_view str = escaped;
+    if (escaped.find('\\') != std::string::npos) {
+        decoded = Unescape(escaped);
+        str = decoded;
+    }
+    size_t length = 0;
+    for (char c : str) {
+        length += (static_cast<unsigned char>(c) & 0xc0) != 0x80;
+    }
+    return length;
+}
+
+const char *Schema::Check(const Json &json) const {
+    if (json.type == JsonType::jnumber) {
+        if (const char *message = CheckNumber(*json.Get<double>())) {
+            return message;
+        }
+    } else if (json.type == JsonType::jstring &&
+               (min_length > 0 || max_length != unbounded)) {
+        size_t length =
+            Length(static_cast<const JsonString &>(*json.value).value);
+        if (length < min_length) {
+            return "String is shorter than the schema allows";
+        }
+        if (length > max_length) {
+            return "String is longer than the schema allows";
+        }
+    }
+    if (has_enumeration) {
+        for (auto &val : enumeration) {
+            if (val == json) {
+                return nullptr;
+            }
+        }
+        return "Value is not one of the schema enum values";
+    }
+    return nullptr;
+}
+
+const char *Schema::CheckPacked(JsonType type, double val) const {
+    if (const char *message = CheckType(type)) {
+        return message;
+    }
+    if (type == JsonType::jnumber) {
+        if (const char *message = CheckNumber(val)) {
+            return message;
+        }
+    }
+    if (has_enumeration) {
+        for (auto &item : enumeration) {
+            if (item.type == type &&
+                (type == JsonType::jnumber ? *item.Get<double>() == val
+                                           : *item.Get<bool>() == (val != 0))) {
+                return nullptr;
+            }
+        }
+        return "Value is not one of the schema enum values";
+    }
+    return nullptr;
+}
+} // namespace sjp
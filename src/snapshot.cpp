@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error.hpp"
+#include "snapshot.hpp"
+
+namespace sjp {
+namespace {
+enum Tag : uint8_t {
+    tag_null,
+    tag_false,
+    tag_true,
+    tag_number,
+    tag_string,
+    tag_array,
+    tag_object
+};
+
+constexpr char magic[4] = {'S', 'J', 'P', 'S'};
+constexpr uint16_t byte_order_mark = 0x0102;
+constexpr size_t header_size = 16;
+
+template <typename T> void Put(std::string &out, T val) {
+    out.append(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+template <typename T> void PutAt(std::string &out, size_t pos, T val) {
+    std::memcpy(out.data() + pos, &val, sizeof(val));
+}
+
+uint32_t Offset(const std::string &out) {
+    if (out.size() > std::numeric_limits<uint32_t>::max()) {
+        THROW_ERROR("Snapshot exceeds 4GiB");
+    }
+    return static_cast<uint32_t>(out.size());
+}
+
+uint32_t Count(size_t count) {
+    if (count > std::numeric_limits<uint32_t>::max()) {
+        THROW_ERROR("Snapshot exceeds 4GiB");
+    }
+    return static_cast<uint32_t>(count);
+}
+
+void PutString(std::string &out, std::string_view str) {
+    Put(out, Count(str.size()));
+    out.append(str);
+}
+
+void WriteNode(std::string &out, const Json &json) {
+    switch (json.type) {
+    case JsonType::jnull:
+        out += static_cast<char>(tag_null);
+        break;
+    case JsonType::jbool:
+        out += static_cast<char>(json.Get<bool>().value() ? tag_true
+                                                           : tag_false);
+        break;
+    case JsonType::jnumber:
+        out += static_cast<char>(tag_number);
+        Put(out, json.Get<double>().value());
+        break;
+    case JsonType::jstring:
+        out += static_cast<char>(tag_string);
+        PutString(out, static_cast<const JsonString &>(*json.value).value);
+        break;
+    case JsonType::jarray: {
+        const auto &arr = static_cast<const JsonArray &>(*json.value);
+        out += static_cast<char>(tag_array);
+        Put(out, Count(arr.Size()));
+        size_t table = out.size();
+        out.append(sizeof(uint32_t) * arr.Size(), '\0');
+        for (size_t i = 0; i < arr.Size(); ++i) {
+            PutAt(out, table + sizeof(uint32_t) * i, Offset(out));
+            switch (arr.Packing()) {
+            case JsonArray::Storage::numbers:
+                out += static_cast<char>(tag_number);
+                Put(out, arr.Numbers()[i]);
+                break;
+            case JsonArray::Storage::bools:
+                out += static_cast<char>(arr.Bools()[i] ? tag_true : tag_false);
+                break;
+            case JsonArray::Storage::generic:
+                WriteNode(out, arr.Items()[i]);
+                break;
+            }
+        }
+    } break;
+    case JsonType::jobject: {
+        const auto &items =
+            static_cast<const JsonObject &>(*json.value).Items();
+        std::vector<const std::pair<const std::string, Json> *> entries;
+        entries.reserve(items.size());
+        for (auto &item : items) {
+            entries.push_back(&item);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](auto *a, auto *b) { return a->first < b->first; });
+
+        out += static_cast<char>(tag_object);
+        Put(out, Count(entries.size()));
+        size_t table = out.size();
+        out.append(2 * sizeof(uint32_t) * entries.size(), '\0');
+        for (size_t i = 0; i < entries.size(); ++i) {
+            size_t entry = table + 2 * sizeof(uint32_t) * i;
+            PutAt(out, entry, Offset(out));
+            PutString(out, entries[i]->first);
+            PutAt(out, entry + sizeof(uint32_t), Offset(out));
+            WriteNode(out, entries[i]->second);
+        }
+    } break;
+    }
+}
+
+template <typename T> T Read(const char *data, size_t size, size_t pos) {
+    if (pos > size || size - pos < sizeof(T)) {
+        THROW_ERROR("Corrupt snapshot");
+    }
+    T val;
+    std::memcpy(&val, data + pos, sizeof(T));
+    return val;
+}
+
+std::string_view ReadString(const char *data, size_t size, size_t pos) {
+    auto len = Read<uint32_t>(data, size, pos);
+    pos += sizeof(uint32_t);
+    if (size - pos < len) {
+        THROW_ERROR("Corrupt snapshot");
+    }
+    return {data + pos, len};
+}
+
+void CheckHeader(const char *data, size_t size) {
+    if (size < header_size || std::memcmp(data, magic, sizeof(magic)) != 0) {
+        THROW_ERROR("Invalid snapshot header");
+    }
+    if (Read<uint16_t>(data, size, 4) != Snapshot::version) {
+        THROW_ERROR("Unsupported snapshot version");
+    }
+    if (Read<uint16_t>(data, size, 6) != byte_order_mark) {
+        THROW_ERROR("Snapshot byte order mismatch");
+    }
+    if (Read<uint64_t>(data, size, 8) != size) {
+        THROW_ERROR("Truncated snapshot");
+    }
+}
+} // namespace
+
+JsonType SnapshotView::Type() const {
+    switch (Read<uint8_t>(data, size, offset)) {
+    case tag_null:
+        return JsonType::jnull;
+    case tag_false:
+    case tag_true:
+        return JsonType::jbool;
+    case tag_number:
+        return JsonType::jnumber;
+    case tag_string:
+        return JsonType::jstring;
+    case tag_array:
+        return JsonType::jarray;
+    case tag_object:
+        return JsonType::jobject;
+    default: {
+        THROW_ERROR("Corrupt snapshot");
+    }
+    }
+}
+
+size_t SnapshotView::Size() const {
+    auto tag = Read<uint8_t>(data, size, offset);
+    if (tag != tag_array && tag != tag_object) {
+        return 0;
+    }
+    return Read<uint32_t>(data, size, offset + 1);
+}
+
+std::optional<SnapshotView> SnapshotView::Get(size_t idx) const {
+    if (Read<uint8_t>(data, size, offset) != tag_array ||
+        idx >= Read<uint32_t>(data, size, offset + 1)) {
+        return std::nullopt;
+    }
+    size_t pos = offset + 5 + sizeof(uint32_t) * idx;
+    return SnapshotView(data, size, Read<uint32_t>(data, size, pos));
+}
+
+std::optional<SnapshotView> SnapshotView::Get(std::string_view key) const {
+    if (Read<uint8_t>(data, size, offset) != tag_object) {
+        return std::nullopt;
+    }
+    // entries are sorted by key
+    size_t lo = 0;
+    size_t hi = Read<uint32_t>(data, size, offset + 1);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        size_t entry = offset + 5 + 2 * sizeof(uint32_t) * mid;
+        auto cmp = ReadString(data, size, Read<uint32_t>(data, size, entry))
+                       .compare(key);
+        if (cmp == 0) {
+            return SnapshotView(
+                data, size,
+                Read<uint32_t>(data, size, entry + sizeof(uint32_t)));
+        } else if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string_view> SnapshotView::GetString() const {
+    if (Read<uint8_t>(data, size, offset) != tag_string) {
+        return std::nullopt;
+    }
+    return ReadString(data, size, offset + 1);
+}
+
+std::optional<double> SnapshotView::GetNumber() const {
+    if (Read<uint8_t>(data, size, offset) != tag_number) {
+        return std::nullopt;
+    }
+    return Read<double>(data, size, offset + 1);
+}
+
+std::optional<bool> SnapshotView::GetBool() const {
+    auto tag = Read<uint8_t>(data, size, offset);
+    if (tag != tag_false && tag != tag_true) {
+        return std::nullopt;
+    }
+    return tag == tag_true;
+}
+
+Json SnapshotView::ToJson() const {
+    switch (Type()) {
+    case JsonType::jnull:
+        return Json{.type = JsonType::jnull,
+                    .value = std::make_shared<JsonNull>(JNull{})};
+    case JsonType::jbool:
+        return Json{.type = JsonType::jbool,
+                    .value = std::make_shared<JsonBool>(*GetBool())};
+    case JsonType::jnumber:
+        return Json{.type = JsonType::jnumber,
+                    .value = std::make_shared<JsonNumber>(*GetNumber())};
+    case JsonType::jstring:
+        return Json{.type = JsonType::jstring,
+                    .value = std::make_shared<JsonString>(
+                        std::string(*GetString()))};
+    case JsonType::jarray: {
+        std::vector<Json> arr;
+        arr.reserve(Size());
+        for (size_t i = 0; i < Size(); ++i) {
+            arr.emplace_back(Get(i)->ToJson());
+        }
+        return Json{.type = JsonType::jarray,
+                    .value = std::make_shared<JsonArray>(std::move(arr))};
+    }
+    case JsonType::jobject: {
+        std::unordered_map<std::string, Json> pairs;
+        pairs.reserve(Size());
+        for (size_t i = 0; i < Size(); ++i) {
+            size_t entry = offset + 5 + 2 * sizeof(uint32_t) * i;
+            auto key =
+                ReadString(data, size, Read<uint32_t>(data, size, entry));
+            SnapshotView val(
+                data, size,
+                Read<uint32_t>(data, size, entry + sizeof(uint32_t)));
+            pairs.emplace(key, val.ToJson());
+        }
+        return Json{.type = JsonType::jobject,
+                    .value = std::make_shared<JsonObject>(std::move(pairs))};
+    }
+    }
+    THROW_ERROR("Corrupt snapshot");
+}
+
+Snapshot::Snapshot(std::shared_ptr<const char> data, size_t size)
+    : data(std::move(data)), size(size) {}
+
+std::string Snapshot::Write(const Json &json) {
+    std::string out(magic, sizeof(magic));
+    Put(out, version);
+    Put(out, byte_order_mark);
+    Put(out, uint64_t{0});
+    WriteNode(out, json);
+    PutAt(out, 8, static_cast<uint64_t>(out.size()));
+    return out;
+}
+
+void Snapshot::Save(const Json &json, const std::string &path) {
+    std::string bytes = Write(json);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file) {
+        THROW_ERROR("Error writing snapshot");
+    }
+}
+
+Snapshot Snapshot::Freeze(const Json &json) {
+    auto bytes = std::make_shared<const std::string>(Write(json));
+    return Snapshot(std::shared_ptr<const char>(bytes, bytes->data()),
+                    bytes->size());
+}
+
+Snapshot Snapshot::Load(std::string_view bytes) {
+    CheckHeader(bytes.data(), bytes.size());
+    return Snapshot(std::shared_ptr<const char>(bytes.data(),
+                                                [](const char *) {}),
+                    bytes.size());
+}
+
+Snapshot Snapshot::Map(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        THROW_ERROR("Error opening snapshot");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        THROW_ERROR("Error opening snapshot");
+    }
+    auto len = static_cast<size_t>(st.st_size);
+    void *addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        THROW_ERROR("Error mapping snapshot");
+    }
+    std::shared_ptr<const char> data(
+        static_cast<const char *>(addr),
+        [len](const char *ptr) { munmap(const_cast<char *>(ptr), len); });
+    CheckHeader(data.get(), len);
+    return Snapshot(std::move(data), len);
+}
+
+SnapshotView Snapshot::Root() const {
+    return SnapshotView(data.get(), size, header_size);
+}
+} // namespace sjp
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <charconv>
+
+#include "error.hpp"
+#include "escape.hpp"
+#include "splice.hpp"
+#include "writer.hpp"
+
+namespace sjp {
+static bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+namespace {
+// Knows just enough json to step over values: strings with their escapes,
+// comments and the nesting of brackets. Nothing is decoded or built.
+struct Scanner {
+    std::string_view json;
+    size_t pos = 0;
+
+    char Peek() const {
+        if (pos >= json.size()) {
+            THROW_ERROR("Unexpected end of json");
+        }
+        return json[pos];
+    }
+
+    // Skips a // or /* */ comment at pos, false if there is none.
+    bool Comment() {
+        if (pos + 1 >= json.size() || json[pos] != '/') {
+            return false;
+        }
+        if (json[pos + 1] == '/') {
+            pos = std::min(json.find('\n', pos), json.size());
+        } else if (json[pos + 1] == '*') {
+            size_t end = json.find("*/", pos + 2);
+            if (end == std::string_view::npos) {
+                THROW_ERROR("Unterminated comment");
+            }
+            pos = end + 2;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void Space() {
+        while (pos < json.size()) {
+            if (IsSpace(json[pos])) {
+                ++pos;
+            } else if (!Comment()) {
+                return;
+            }
+        }
+    }
+
+    void Expect(char c) {
+        if (Peek() != c) {
+            THROW_ERROR("Malformed json");
+        }
+        ++pos;
+    }
+
+    // The raw bytes between the quotes.
+    std::string_view String() {
+        Expect('"');
+        size_t begin = pos;
+        while (Peek() != '"') {
+            pos += json[pos] == '\\' ? 2 : 1;
+        }
+        return json.substr(begin, pos++ - begin);
+    }
+
+    void Value() {
+        char c = Peek();
+        if (c == '"') {
+            String();
+        } else if (c == '{' || c == '[') {
+            size_t depth = 0;
+            do {
+                c = Peek();
+                if (c == '"') {
+                    String();
+                    continue;
+                }
+                if (Comment()) {
+                    continue;
+                }
+                if (c == '{' || c == '[') {
+                    ++depth;
+                } else if (c == '}' || c == ']') {
+                    --depth;
+                }
+                ++pos;
+            } while (depth);
+        } else {
+            size_t begin = pos;
+            while (pos < json.size() && !IsSpace(json[pos]) &&
+                   json[pos] != ',' && json[pos] != ']' && json[pos] != '}' &&
+                   json[pos] != '/') {
+                ++pos;
+            }
+            if (pos == begin) {
+                THROW_ERROR("Malformed json");
+            }
+        }
+    }
+};
+
+struct Location {
+    std::optional<Span> value;
+    bool parent = false;  // the container holding the last token exists
+    bool object = false;  // that container is an object
+    size_t member = 0;    // where the member starts, its key for objects
+    size_t previous = 0;  // end of the member before it, 0 for the first
+    size_t close = 0;     // the closing bracket, when the token is missing
+    bool empty = false;   // the container has no members
+};
+} // namespace
+
+// nullopt for "-" and anything that is not a plain index
+static std::optional<size_t> Index(const std::string &token) {
+    size_t idx = 0;
+    const char *end = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), end, idx);
+    if (token.empty() || ec != std::errc() || ptr != end ||
+        (token[0] == '0' && token.size() > 1)) {
+        return std::nullopt;
+    }
+    return idx;
+}
+
+static Location Find(std::string_view json, std::string_view pointer) {
+    Location location;
+    Scanner scan{json};
+    scan.Space();
+    auto tokens = PointerTokens(pointer);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        auto &token = tokens[i];
+        char open = scan.Peek();
+        if (open != '{' && open != '[') {
+            return {};
+        }
+        char close = open == '{' ? '}' : ']';
+        auto index = open == '[' ? Index(token) : std::nullopt;
+        location = {};
+        ++scan.pos;
+        size_t count = 0;
+        bool found = false;
+        for (;; ++count) {
+            scan.Space();
+            if (scan.Peek() == close) {
+                break;
+            }
+            if (count) {
+                location.previous = scan.pos;
+                scan.Expect(',');
+                scan.Space();
+            }
+            location.member = scan.pos;
+            if (open == '{') {
+                auto key = scan.String();
+                scan.Space();
+                scan.Expect(':');
+                scan.Space();
+                found = key == token;
+            } else {
+                found = index == count;
+            }
+            if (found) {
+                break;
+            }
+            scan.Value();
+        }
+        if (!found) {
+            // only the last token may be missing
+            if (i + 1 < tokens.size()) {
+                return {};
+            }
+            location.parent = true;
+            location.object = open == '{';
+            location.close = scan.pos;
+            location.empty = count == 0;
+            return location;
+        }
+        location.object = open == '{';
+    }
+    size_t begin = scan.pos;
+    scan.Value();
+    location.value = Span{begin, scan.pos};
+    location.parent = true;
+    return location;
+}
+
+std::optional<Span> Locate(std::string_view json, std::string_view pointer) {
+    return Find(json, pointer).value;
+}
+
+std::string Splice(std::string_view json, std::string_view pointer,
+                   const Json &value) {
+    Location location = Find(json, pointer);
+    if (!location.parent) {
+        THROW_ERROR("Splice path does not resolve");
+    }
+    auto tokens = PointerTokens(pointer);
+    if (!location.value && (tokens.empty() ||
+                            (!location.object && tokens.back() != "-"))) {
+        THROW_ERROR("Splice path does not resolve");
+    }
+    size_t begin = location.value ? location.value->begin : location.close;
+    size_t end = location.value ? location.value->end : location.close;
+
+    std::string out;
+    out.reserve(json.size() + 64);
+    out.append(json.substr(0, begin));
+    if (!location.value) {
+        if (!location.empty) {
+            out += ',';
+        }
+        if (location.object) {
+            out += '"';
+            out += tokens.back();
+            out += "\":";
+        }
+    }
+    JsonWriter(out).Value(value);
+    out.append(json.substr(end));
+    return out;
+}
+
+std::string SpliceRemove(std::string_view json, std::string_view pointer) {
+    Location location = Find(json, pointer);
+    if (!location.value || PointerTokens(pointer).empty()) {
+        THROW_ERROR("Splice path does not resolve");
+    }
+    size_t begin = location.member;
+    Scanner scan{json, location.value->end};
+    scan.Space();
+    if (scan.pos < json.size() && json[scan.pos] == ',') {
+        // the next member moves up to where this one started
+        ++scan.pos;
+        scan.Space();
+    } else if (location.previous) {
+        // the last member takes the comma before it along
+        begin = location.previous;
+        scan.pos = location.value->end;
+    } else {
+        scan.pos = location.value->end;
+    }
+    std::string out;
+    out.reserve(json.size());
+    out.append(json.substr(0, begin));
+    out.append(json.substr(scan.pos));
+    return out;
+}
+} // namespace sjp
@@ -1,40 +1,114 @@
-#include <cstdlib>
+#include <cctype>
+#include <charconv>
 #include <sstream>
-#include <stdexcept>
+#include <string_view>
 
 #include "tokenizer.hpp"
 
 namespace sjp {
+static constexpr int eof = std::istringstream::traits_type::eof();
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool IsNumber(std::string_view str) {
+    size_t pos = 0;
+    auto digits = [&] {
+        size_t start = pos;
+        while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9') {
+            ++pos;
+        }
+        return pos - start;
+    };
+    if (pos < str.size() && str[pos] == '-') {
+        ++pos;
+    }
+    if (pos < str.size() && str[pos] == '0') {
+        ++pos;
+    } else if (digits() == 0) {
+        return false;
+    }
+    if (pos < str.size() && str[pos] == '.') {
+        ++pos;
+        if (digits() == 0) {
+            return false;
+        }
+    }
+    if (pos < str.size() && (str[pos] == 'e' || str[pos] == 'E')) {
+        ++pos;
+        if (pos < str.size() && (str[pos] == '+' || str[pos] == '-')) {
+            ++pos;
+        }
+        if (digits() == 0) {
+            return false;
+        }
+    }
+    return pos == str.size();
+}
+
+void Tokenizer::Reset(std::istream &stream, bool raw, size_t max) {
+    token_stream = &stream;
+    token = Token{TokenType::start, {}};
+    error = {};
+    raw_numbers = raw;
+    max_lexeme = max;
+    offset = 0;
+    line = 1;
+    column = 1;
+    Advance();
+}
+
+int Tokenizer::Get() {
+    int c = token_stream->get();
+    if (c == '\n') {
+        ++line;
+        column = 1;
+    } else if (c != eof) {
+        ++column;
+    }
+    if (c != eof) {
+        ++offset;
+    }
+    return c;
+}
+
+// Errors are reported at the start of the token being read.
+void Tokenizer::Fail(ParseErrorCode code, const char *message) {
+    token.type = TokenType::error;
+    error = {code, token.offset, token.line, token.column, message};
+}
+
 void Tokenizer::Advance() {
-    if (token.type == TokenType::end)
+    if (token.type == TokenType::end || token.type == TokenType::error)
         return;
 
     char c;
     while (true) {
-        if (token_stream.peek() == std::istringstream::traits_type::eof()) {
+        token.offset = offset;
+        token.line = line;
+        token.column = column;
+        if (token_stream->peek() == eof) {
             token.type = TokenType::end;
             return;
         }
-        c = static_cast<char>(token_stream.peek());
+        c = static_cast<char>(token_stream->peek());
         switch (c) {
         case '{': {
             token.type = TokenType::left_braces;
-            token_stream.get();
+            Get();
             return;
         }
         case '}': {
             token.type = TokenType::right_braces;
-            token_stream.get();
+            Get();
             return;
         }
         case '[': {
             token.type = TokenType::left_bracket;
-            token_stream.get();
+            Get();
             return;
         }
         case ']': {
             token.type = TokenType::right_bracket;
-            token_stream.get();
+            Get();
             return;
         }
         case '"': {
@@ -43,26 +117,31 @@ void Tokenizer::Advance() {
         }
         case ':': {
             token.type = TokenType::colon;
-            token_stream.get();
+            Get();
             return;
         }
         case ',': {
             token.type = TokenType::comma;
-            token_stream.get();
+            Get();
             return;
         }
         case '\n':
         case ' ': {
-            token_stream.get();
+            Get();
             break;
         }
         case '/': {
-            token_stream.get();
-            c = static_cast<char>(token_stream.peek());
+            Get();
+            c = static_cast<char>(token_stream->peek());
             if (c == '/' || c == '*') {
                 SkipComments(c == '*');
+                if (token.type == TokenType::error) {
+                    return;
+                }
             } else {
-                THROW_ERROR("Unexpected error parsing json string");
+                Fail(ParseErrorCode::invalid_comment,
+                     "Unexpected error parsing json string");
+                return;
             }
             break;
         }
@@ -74,86 +153,173 @@ void Tokenizer::Advance() {
     }
 }
 
+bool Tokenizer::OverLimit() {
+    if (scratch.size() <= max_lexeme) {
+        return false;
+    }
+    Fail(ParseErrorCode::memory_limit, "Document exceeds the allocation limit");
+    return true;
+}
+
+// The string is collected in scratch and copied out once at its final
+// size.
 void Tokenizer::ReadQuotedString() {
-    std::ostringstream value;
+    scratch.clear();
     // first quote
-    token_stream.get();
-    char c = static_cast<char>(token_stream.peek());
-    while (token_stream.peek() != std::istringstream::traits_type::eof() &&
-           c != '"') {
+    Get();
+    int c;
+    while ((c = token_stream->peek()) != eof && c != '"') {
         if (c == '\\') {
-            value << static_cast<char>(token_stream.get());
-            c = static_cast<char>(token_stream.peek());
-            if (!(c != '"' || c != '\\' || c != '\n' || c == '\t')) {
-                THROW_ERROR("Invalid char after escape sequence");
+            scratch += static_cast<char>(Get());
+            if (token_stream->peek() == eof) {
+                break;
             }
         }
-        value << static_cast<char>(token_stream.get());
-        c = static_cast<char>(token_stream.peek());
+        scratch += static_cast<char>(Get());
+        if (OverLimit()) {
+            return;
+        }
     }
-    if (token_stream.peek() == std::istringstream::traits_type::eof()) {
-        THROW_ERROR("Unexpected end of parsing");
+    if (token_stream->peek() == eof) {
+        Fail(ParseErrorCode::unexpected_end, "Unexpected end of parsing");
+        return;
     }
-    token_stream.get();
+    Get();
     token.type = TokenType::quoted_str;
-    token.value = value.str();
+    token.value = scratch;
 }
 
 void Tokenizer::ReadValue() {
-    std::ostringstream value;
-    char c = static_cast<char>(token_stream.peek());
+    scratch.clear();
+    int c = token_stream->peek();
     do {
         if (!std::isspace(c)) {
-            value << static_cast<char>(c);
+            scratch += static_cast<char>(c);
+            if (OverLimit()) {
+                return;
+            }
         }
-        token_stream.get();
-        c = static_cast<char>(token_stream.peek());
-    } while (token_stream.peek() != std::istringstream::traits_type::eof() &&
-             c != '}' && c != ',' && c != ']');
+        Get();
+        c = token_stream->peek();
+    } while (c != eof && c != '}' && c != ',' && c != ']');
 
-    if (value.str() == "null") {
+    if (scratch == "null") {
         token.type = TokenType::jnull;
-    } else if (value.str() == "true" || value.str() == "false") {
+    } else if (scratch == "true" || scratch == "false") {
         token.type = TokenType::jbool;
-        token.value = value.str() == "true";
+        token.value = scratch == "true";
+    } else if (raw_numbers) {
+        if (IsNumber(scratch)) {
+            token.type = TokenType::number;
+            token.value = scratch;
+        } else {
+            Fail(ParseErrorCode::invalid_number, "Error parsing json number");
+        }
     } else {
-        try {
-            size_t len;
-            double number = std::stod(value.str(), &len);
-            if (len != value.str().size()) {
-                THROW_ERROR("Error parsing json number");
-            }
+        double number;
+        const char *end = scratch.data() + scratch.size();
+        auto [ptr, ec] = std::from_chars(scratch.data(), end, number);
+        if (ec == std::errc::result_out_of_range) {
+            Fail(ParseErrorCode::number_out_of_range,
+                 "Error parsing json number - number out of range");
+        } else if (ec != std::errc() || ptr != end) {
+            Fail(ParseErrorCode::invalid_number, "Error parsing json number");
+        } else {
             token.type = TokenType::number;
             token.value = number;
-        } catch (const std::invalid_argument &e) {
-            THROW_ERROR("Error parsing json number - invalid argument");
-        } catch (const std::out_of_range &e) {
-            THROW_ERROR("Error parsing json number - number out of range");
         }
     }
 }
 
+void Tokenizer::SkipValue() {
+    switch (token.type) {
+    case TokenType::left_braces:
+    case TokenType::left_bracket:
+        break;
+    case TokenType::quoted_str:
+    case TokenType::number:
+    case TokenType::jbool:
+    case TokenType::jnull:
+        Advance();
+        return;
+    case TokenType::error:
+        return;
+    default: {
+        Fail(ParseErrorCode::unexpected_token, "Expected a json value");
+        return;
+    }
+    }
+
+    size_t depth = 1;
+    while (depth > 0) {
+        int c = Get();
+        switch (c) {
+        case eof: {
+            Fail(ParseErrorCode::unexpected_end, "Unexpected end of parsing");
+            return;
+        }
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            --depth;
+            break;
+        case '"': {
+            while ((c = Get()) != '"') {
+                if (c == eof) {
+                    Fail(ParseErrorCode::unexpected_end,
+                         "Unexpected end of parsing");
+                    return;
+                }
+                if (c == '\\') {
+                    Get();
+                }
+            }
+        } break;
+        case '/': {
+            c = token_stream->peek();
+            if (c == '/' || c == '*') {
+                SkipComments(c == '*');
+                if (token.type == TokenType::error) {
+                    return;
+                }
+            } else {
+                Fail(ParseErrorCode::invalid_comment,
+                     "Unexpected error parsing json string");
+                return;
+            }
+        } break;
+        default:
+            break;
+        }
+    }
+    Advance();
+}
+
 void Tokenizer::SkipComments(bool multi) {
-    token_stream.get();
+    Get();
     // comment starts
     if (multi) {
-        while (token_stream.peek() != std::istringstream::traits_type::eof()) {
-            char c = static_cast<char>(token_stream.get());
+        while (token_stream->peek() != eof) {
+            char c = static_cast<char>(Get());
             if (c == '*') {
-                if (token_stream.peek() == '/') {
-                    token_stream.get();
+                if (token_stream->peek() == '/') {
+                    Get();
                     return;
                 }
             }
         }
     } else {
-        while (token_stream.peek() != std::istringstream::traits_type::eof()) {
-            char c = static_cast<char>(token_stream.get());
+        while (token_stream->peek() != eof) {
+            char c = static_cast<char>(Get());
             if (c == '\n') {
                 return;
             }
         }
     }
-    THROW_ERROR("Unexpected error parsing json string");
+    Fail(ParseErrorCode::invalid_comment,
+         "Unexpected error parsing json string");
 }
 } // namespace sjp
@@ -0,0 +1,375 @@
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "validate.hpp"
+
+namespace sjp {
+namespace {
+using Status = ValidationStatus;
+
+constexpr uint64_t Broadcast(uint8_t c) { return 0x0101010101010101ULL * c; }
+
+// Bytes that can be copied over blindly inside a string: printable ASCII
+// other than the quote and the backslash. Returns how many bytes from p on
+// fall in that class.
+size_t PlainRun(const char *p, const char *end) {
+    const char *start = p;
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        // the signed compare flags control characters and non-ASCII bytes
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                         _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmplt_epi8(chunk, space));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (mask != 0) {
+            return static_cast<size_t>(p - start) +
+                   static_cast<size_t>(__builtin_ctz(mask));
+        }
+        p += 16;
+    }
+#else
+    constexpr uint64_t high = Broadcast(0x80);
+    while (end - p >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        uint64_t quote = word ^ Broadcast('"');
+        uint64_t backslash = word ^ Broadcast('\\');
+        uint64_t special =
+            ((word - Broadcast(0x20)) | (quote - Broadcast(0x01)) |
+             (backslash - Broadcast(0x01)) | word) &
+            high;
+        if (special != 0) {
+            break;
+        }
+        p += 8;
+    }
+#endif
+    while (p != end) {
+        auto c = static_cast<unsigned char>(*p);
+        if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') {
+            break;
+        }
+        ++p;
+    }
+    return static_cast<size_t>(p - start);
+}
+
+// Length of the UTF-8 sequence at p, 0 if it is malformed (RFC 3629).
+size_t Utf8Sequence(const unsigned char *p, const unsigned char *end) {
+    unsigned char c = *p;
+    size_t len;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        len = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) {
+            lo = 0xA0; // overlong
+        } else if (c == 0xED) {
+            hi = 0x9F; // surrogates
+        }
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) {
+            lo = 0x90; // overlong
+        } else if (c == 0xF4) {
+            hi = 0x8F; // above U+10FFFF
+        }
+    } else {
+        return 0;
+    }
+    if (static_cast<size_t>(end - p) < len || p[1] < lo || p[1] > hi) {
+        return 0;
+    }
+    for (size_t i = 2; i < len; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+bool IsHex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+           (c >= 'A' && c <= 'F');
+}
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+class Validator {
+  public:
+    Validator(std::string_view json)
+        : begin(json.data()), p(json.data()), end(json.data() + json.size()) {
+    }
+
+    ValidationResult Run();
+
+  private:
+    const char *begin;
+    const char *p;
+    const char *end;
+    size_t depth = 0;
+    // one bit per nesting level, set for objects
+    uint64_t stack[max_validation_depth / 64] = {};
+
+    ValidationResult Error(Status status) const {
+        return {status, static_cast<size_t>(p - begin)};
+    }
+
+    void SkipWhitespace() {
+        while (p != end &&
+               (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+    }
+
+    bool InObject() const {
+        size_t level = depth - 1;
+        return (stack[level / 64] >> (level % 64)) & 1;
+    }
+
+    bool Push(bool object) {
+        if (depth == max_validation_depth) {
+            return false;
+        }
+        uint64_t bit = uint64_t{1} << (depth % 64);
+        if (object) {
+            stack[depth / 64] |= bit;
+        } else {
+            stack[depth / 64] &= ~bit;
+        }
+        ++depth;
+        return true;
+    }
+
+    Status String();
+    Status Number();
+    Status Literal(std::string_view literal);
+    Status Key();
+};
+
+Status Validator::String() {
+    ++p; // opening quote
+    while (true) {
+        p += PlainRun(p, end);
+        if (p == end) {
+            return Status::unexpected_end;
+        }
+        auto c = static_cast<unsigned char>(*p);
+        if (c == '"') {
+            ++p;
+            return Status::ok;
+        } else if (c == '\\') {
+            if (end - p < 2) {
+                return Status::unexpected_end;
+            }
+            switch (p[1]) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                p += 2;
+                break;
+            case 'u':
+                for (int i = 2; i < 6; ++i) {
+                    if (p + i == end) {
+                        return Status::unexpected_end;
+                    }
+                    if (!IsHex(p[i])) {
+                        return Status::invalid_escape;
+                    }
+                }
+                p += 6;
+                break;
+            default:
+                return Status::invalid_escape;
+            }
+        } else if (c < 0x20) {
+            return Status::control_character;
+        } else {
+            size_t len =
+                Utf8Sequence(reinterpret_cast<const unsigned char *>(p),
+                             reinterpret_cast<const unsigned char *>(end));
+            if (len == 0) {
+                return Status::invalid_utf8;
+            }
+            p += len;
+        }
+    }
+}
+
+Status Validator::Number() {
+    const char *start = p;
+    if (*p == '-') {
+        ++p;
+    }
+    if (p == end || !IsDigit(*p)) {
+        p = start;
+        return Status::invalid_number;
+    }
+    if (*p == '0') {
+        ++p;
+    } else {
+        while (p != end && IsDigit(*p)) {
+            ++p;
+        }
+    }
+    if (p != end && *p == '.') {
+        ++p;
+        if (p == end || !IsDigit(*p)) {
+            return Status::invalid_number;
+        }
+        while (p != end && IsDigit(*p)) {
+            ++p;
+        }
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p != end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (p == end || !IsDigit(*p)) {
+            return Status::invalid_number;
+        }
+        while (p != end && IsDigit(*p)) {
+            ++p;
+        }
+    }
+    return Status::ok;
+}
+
+Status Validator::Literal(std::string_view literal) {
+    if (static_cast<size_t>(end - p) < literal.size() ||
+        std::memcmp(p, literal.data(), literal.size()) != 0) {
+        return Status::invalid_literal;
+    }
+    p += literal.size();
+    return Status::ok;
+}
+
+// Reads `"key" :` inside an object.
+Status Validator::Key() {
+    SkipWhitespace();
+    if (p == end) {
+        return Status::unexpected_end;
+    }
+    if (*p != '"') {
+        return Status::unexpected_character;
+    }
+    if (auto status = String(); status != Status::ok) {
+        return status;
+    }
+    SkipWhitespace();
+    if (p == end) {
+        return Status::unexpected_end;
+    }
+    if (*p != ':') {
+        return Status::unexpected_character;
+    }
+    ++p;
+    return Status::ok;
+}
+
+ValidationResult Validator::Run() {
+    while (true) {
+        // expecting a value
+        SkipWhitespace();
+        if (p == end) {
+            return Error(Status::unexpected_end);
+        }
+        Status status = Status::ok;
+        bool opened = false;
+        switch (*p) {
+        case '{':
+        case '[': {
+            bool object = *p == '{';
+            if (!Push(object)) {
+                return Error(Status::nesting_too_deep);
+            }
+            ++p;
+            SkipWhitespace();
+            if (p != end && *p == (object ? '}' : ']')) {
+                ++p;
+                --depth;
+            } else if (object) {
+                status = Key();
+                opened = true;
+            } else {
+                opened = true;
+            }
+        } break;
+        case '"':
+            status = String();
+            break;
+        case 't':
+            status = Literal("true");
+            break;
+        case 'f':
+            status = Literal("false");
+            break;
+        case 'n':
+            status = Literal("null");
+            break;
+        default:
+            if (*p == '-' || IsDigit(*p)) {
+                status = Number();
+            } else {
+                status = Status::unexpected_character;
+            }
+        }
+        if (status != Status::ok) {
+            return Error(status);
+        }
+        if (opened) {
+            continue;
+        }
+
+        // after a value, close containers until one wants another value
+        while (true) {
+            SkipWhitespace();
+            if (depth == 0) {
+                if (p != end) {
+                    return Error(Status::trailing_characters);
+                }
+                return {Status::ok, static_cast<size_t>(end - begin)};
+            }
+            if (p == end) {
+                return Error(Status::unexpected_end);
+            }
+            bool object = InObject();
+            if (*p == ',') {
+                ++p;
+                if (object) {
+                    if (auto status = Key(); status != Status::ok) {
+                        return Error(status);
+                    }
+                }
+                break;
+            } else if (*p == (object ? '}' : ']')) {
+                ++p;
+                --depth;
+            } else {
+                return Error(Status::unexpected_character);
+            }
+        }
+    }
+}
+} // namespace
+
+ValidationResult Validate(std::string_view json) {
+    return Validator(json).Run();
+}
+} // namespace sjp
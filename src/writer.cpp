@@ -0,0 +1,217 @@
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "error.hpp"
+#include "escape.hpp"
+#include "writer.hpp"
+
+namespace sjp {
+JsonWriter::~JsonWriter() {
+    try {
+        Flush();
+    } catch (const std::runtime_error &) {
+    }
+}
+
+void JsonWriter::Flush() {
+    if (fd < 0) {
+        return;
+    }
+    size_t pos = 0;
+    while (pos < buffer.size()) {
+        ssize_t n = write(fd, buffer.data() + pos, buffer.size() - pos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            buffer.erase(0, pos);
+            THROW_ERROR("Error writing json");
+        }
+        pos += static_cast<size_t>(n);
+    }
+    buffer.clear();
+}
+
+void JsonWriter::Indent() {
+    if (style == Style::pretty) {
+        *out += '\n';
+        out->append(4 * scopes.size(), ' ');
+    }
+}
+
+void JsonWriter::BeginValue() {
+    if (scopes.empty()) {
+        return;
+    }
+    Scope &scope = scopes.back();
+    if (scope.object) {
+        assert(pending_key && "json object values need a key");
+        pending_key = false;
+        return;
+    }
+    if (scope.count++ > 0) {
+        *out += ',';
+    }
+    Indent();
+}
+
+void JsonWriter::EndValue() {
+    if (fd >= 0 && buffer.size() >= buffer_size) {
+        Flush();
+    }
+}
+
+void JsonWriter::Start(bool object) {
+    BeginValue();
+    *out += object ? '{' : '[';
+    scopes.push_back({.object = object});
+}
+
+void JsonWriter::End(bool object) {
+    assert(!scopes.empty() && scopes.back().object == object &&
+           "mismatched json scope");
+    assert(!pending_key && "json key without a value");
+    size_t count = scopes.back().count;
+    scopes.pop_back();
+    if (count > 0) {
+        Indent();
+    }
+    *out += object ? '}' : ']';
+    EndValue();
+}
+
+JsonWriter &JsonWriter::StartObject() {
+    Start(true);
+    return *this;
+}
+
+JsonWriter &JsonWriter::EndObject() {
+    End(true);
+    return *this;
+}
+
+JsonWriter &JsonWriter::StartArray() {
+    Start(false);
+    return *this;
+}
+
+JsonWriter &JsonWriter::EndArray() {
+    End(false);
+    return *this;
+}
+
+void JsonWriter::WriteKey(std::string_view key, bool escape) {
+    assert(!scopes.empty() && scopes.back().object && !pending_key &&
+           "json keys belong in objects");
+    if (scopes.back().count++ > 0) {
+        *out += ',';
+    }
+    Indent();
+    *out += '"';
+    if (escape) {
+        AppendEscaped(*out, key);
+    } else {
+        out->append(key);
+    }
+    out->append(style == Style::pretty ? "\": " : "\":");
+    pending_key = true;
+}
+
+JsonWriter &JsonWriter::Key(std::string_view key) {
+    WriteKey(key, true);
+    return *this;
+}
+
+JsonWriter &JsonWriter::Value(std::string_view str) {
+    BeginValue();
+    *out += '"';
+    AppendEscaped(*out, str);
+    *out += '"';
+    EndValue();
+    return *this;
+}
+
+JsonWriter &JsonWriter::Null() {
+    BeginValue();
+    out->append("null");
+    EndValue();
+    return *this;
+}
+
+void JsonWriter::WriteNumber(double number) {
+    if (!std::isfinite(number)) {
+        out->append("null");
+        return;
+    }
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number);
+    out->append(buf, end);
+}
+
+JsonWriter &JsonWriter::Value(const Json &json) {
+    WriteTree(json);
+    return *this;
+}
+
+void JsonWriter::WriteTree(const Json &json) {
+    switch (json.type) {
+    case JsonType::jnull:
+        Null();
+        break;
+    case JsonType::jbool:
+        Value(*json.Get<bool>());
+        break;
+    case JsonType::jnumber:
+        if (auto *lazy =
+                dynamic_cast<const JsonLazyNumber *>(json.value.get())) {
+            BeginValue();
+            out->append(lazy->Lexeme());
+            EndValue();
+        } else {
+            Value(*json.Get<double>());
+        }
+        break;
+    case JsonType::jstring:
+        BeginValue();
+        *out += '"';
+        out->append(static_cast<const JsonString &>(*json.value).value);
+        *out += '"';
+        EndValue();
+        break;
+    case JsonType::jarray: {
+        const auto &arr = static_cast<const JsonArray &>(*json.value);
+        Start(false);
+        switch (arr.Packing()) {
+        case JsonArray::Storage::numbers:
+            for (double number : arr.Numbers()) {
+                Value(number);
+            }
+            break;
+        case JsonArray::Storage::bools:
+            for (bool val : arr.Bools()) {
+                Value(val);
+            }
+            break;
+        case JsonArray::Storage::generic:
+            for (auto &item : arr.Items()) {
+                WriteTree(item);
+            }
+            break;
+        }
+        End(false);
+    } break;
+    case JsonType::jobject:
+        Start(true);
+        for (auto &[key, val] :
+             static_cast<const JsonObject &>(*json.value).Items()) {
+            WriteKey(key, false);
+            WriteTree(val);
+        }
+        End(true);
+        break;
+    }
+}
+} // namespace sjp
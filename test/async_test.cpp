@@ -0,0 +1,146 @@
+#include "async.hpp"
+#include <array>
+#include <cstdio>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace sjp;
+
+static std::vector<EventLoop::Backend> backends() {
+    std::vector<EventLoop::Backend> out{EventLoop::Backend::epoll};
+    try {
+        EventLoop loop(EventLoop::Backend::io_uring);
+        out.push_back(EventLoop::Backend::io_uring);
+    } catch (const std::runtime_error &) {
+    }
+    return out;
+}
+
+static void writeAll(int fd, const std::string &data) {
+    size_t pos = 0;
+    while (pos < data.size()) {
+        ssize_t n = write(fd, data.data() + pos, data.size() - pos);
+        ASSERT_GT(n, 0);
+        pos += static_cast<size_t>(n);
+    }
+}
+
+TEST(AsyncTest, ParsesFile) {
+    std::string path = testing::TempDir() + "sjp_async_test.json";
+    FILE *file = fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    fputs(R"({"a": [1, 2, 3], "b": "x"})", file);
+    fclose(file);
+
+    for (auto backend : backends()) {
+        int fd = open(path.c_str(), O_RDONLY);
+        ASSERT_GE(fd, 0);
+        EventLoop loop(backend);
+        auto task = ParseAsync(loop, fd);
+        loop.Spawn(task);
+        loop.Run();
+        ASSERT_TRUE(task.Done());
+        Json json = task.Result();
+        EXPECT_EQ(json.Get("a")->Size(), 3);
+        EXPECT_EQ(json.Get("b")->Get<std::string>(), "x");
+        close(fd);
+    }
+    std::remove(path.c_str());
+}
+
+// One thread interleaves many documents arriving in pieces.
+TEST(AsyncTest, InterleavesPipes) {
+    constexpr int count = 100;
+    for (auto backend : backends()) {
+        EventLoop loop(backend);
+        std::vector<std::array<int, 2>> pipes(count);
+        std::vector<Task<Json>> tasks;
+        for (auto &fds : pipes) {
+            ASSERT_EQ(pipe(fds.data()), 0);
+            tasks.push_back(ParseAsync(loop, fds[0]));
+            loop.Spawn(tasks.back());
+        }
+        std::thread writer([&pipes] {
+            for (int i = 0; i < count; ++i) {
+                writeAll(pipes[i][1], "{\"id\": " + std::to_string(i));
+            }
+            for (int i = 0; i < count; ++i) {
+                writeAll(pipes[i][1], ", \"tags\": [\"a\", \"b\"]}");
+                close(pipes[i][1]);
+            }
+        });
+        loop.Run();
+        writer.join();
+        for (int i = 0; i < count; ++i) {
+            ASSERT_TRUE(tasks[i].Done());
+            EXPECT_EQ(tasks[i].Result().Get("id")->Get<double>(), i);
+            close(pipes[i][0]);
+        }
+    }
+}
+
+TEST(AsyncTest, LargeDocument) {
+    std::string json = "[";
+    for (int i = 0; i < 50000; ++i) {
+        json += (i ? ", " : "") + std::to_string(i);
+    }
+    json += "]";
+    for (auto backend : backends()) {
+        int fds[2];
+        ASSERT_EQ(pipe(fds), 0);
+        EventLoop loop(backend);
+        auto task = ParseAsync(loop, fds[0]);
+        loop.Spawn(task);
+        std::thread writer([&] {
+            writeAll(fds[1], json);
+            close(fds[1]);
+        });
+        loop.Run();
+        writer.join();
+        EXPECT_EQ(task.Result().Size(), 50000);
+        close(fds[0]);
+    }
+}
+
+Task<size_t> sumSizes(EventLoop &loop, int a, int b) {
+    Json first = co_await ParseAsync(loop, a);
+    Json second = co_await ParseAsync(loop, b);
+    co_return first.Size() + second.Size();
+}
+
+TEST(AsyncTest, TasksCompose) {
+    int a[2], b[2];
+    ASSERT_EQ(pipe(a), 0);
+    ASSERT_EQ(pipe(b), 0);
+    writeAll(a[1], "[1, 2]");
+    writeAll(b[1], "[1, 2, 3]");
+    close(a[1]);
+    close(b[1]);
+    EventLoop loop;
+    auto task = sumSizes(loop, a[0], b[0]);
+    loop.Spawn(task);
+    loop.Run();
+    EXPECT_EQ(task.Result(), 5);
+    close(a[0]);
+    close(b[0]);
+}
+
+TEST(AsyncTest, Errors) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    writeAll(fds[1], "[1, ");
+    close(fds[1]);
+    EventLoop loop;
+    auto task = ParseAsync(loop, fds[0]);
+    loop.Spawn(task);
+    loop.Run();
+    EXPECT_THROW(task.Result(), std::runtime_error);
+    close(fds[0]);
+
+    auto bad = ParseAsync(loop, -1);
+    loop.Spawn(bad);
+    loop.Run();
+    EXPECT_THROW(bad.Result(), std::runtime_error);
+}
@@ -0,0 +1,95 @@
+#include "builder.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static std::string dump(const Json &json) {
+    std::ostringstream out;
+    json.Dump(out);
+    return out.str();
+}
+
+static const JsonArray &array(const Json &json) {
+    return static_cast<const JsonArray &>(*json.value);
+}
+
+TEST(BuilderTest, ToJsonTags) {
+    EXPECT_EQ(ToJson(true).type, JsonType::jbool);
+    EXPECT_EQ(ToJson(JNull{}).type, JsonType::jnull);
+    EXPECT_EQ(ToJson(7).type, JsonType::jnumber);
+    EXPECT_EQ(ToJson(7).Get<int64_t>(), 7);
+    EXPECT_EQ(ToJson("x").type, JsonType::jstring);
+    EXPECT_EQ(ToJson(std::string("y")).Get<std::string>(), "y");
+}
+
+TEST(BuilderTest, ArrayStaysPacked) {
+    ArrayBuilder numbers(3);
+    numbers.Add(1).Add(2.5).Add(uint8_t{3});
+    Json json = std::move(numbers).Build();
+    ASSERT_EQ(json.type, JsonType::jarray);
+    EXPECT_EQ(array(json).Packing(), JsonArray::Storage::numbers);
+    EXPECT_EQ(dump(json), "[1, 2.5, 3]");
+
+    Json bools = MakeArray(true, false);
+    EXPECT_EQ(array(bools).Packing(), JsonArray::Storage::bools);
+    EXPECT_EQ(bools.Get(1)->Get<bool>(), false);
+}
+
+TEST(BuilderTest, ArrayPromotes) {
+    ArrayBuilder builder;
+    builder.Add(1).Add(2).Add(true).Add("s").Add(JNull{});
+    EXPECT_EQ(builder.Size(), 5);
+    Json json = std::move(builder).Build();
+    EXPECT_EQ(array(json).Packing(), JsonArray::Storage::generic);
+    EXPECT_EQ(dump(json), R"([1, 2, true, "s", null])");
+    EXPECT_EQ(json.Get(0)->type, JsonType::jnumber);
+    EXPECT_EQ(json.Get(2)->type, JsonType::jbool);
+    EXPECT_EQ(json.Get(4)->type, JsonType::jnull);
+
+    EXPECT_EQ(dump(MakeArray()), "[]");
+}
+
+TEST(BuilderTest, Object) {
+    ObjectBuilder builder(2);
+    std::string key = "id";
+    builder.Add(std::move(key), 7).Add("id", 8).Add("ok", true);
+    EXPECT_EQ(builder.Size(), 2);
+    Json json = std::move(builder).Build();
+    ASSERT_EQ(json.type, JsonType::jobject);
+    EXPECT_EQ(json.Get("id")->Get<double>(), 8);
+    EXPECT_EQ(json.Get("ok")->type, JsonType::jbool);
+}
+
+TEST(BuilderTest, Nested) {
+    Json json = MakeObject({{"id", 7},
+                            {"name", "a\\\"b"},
+                            {"none", JNull{}},
+                            {"tags", MakeArray("x", MakeArray(1, 2))}});
+    EXPECT_EQ(json.Size(), 4);
+    EXPECT_EQ(json.Get("none")->type, JsonType::jnull);
+    EXPECT_EQ(dump(*json.Get("tags")), R"(["x", [1, 2]])");
+
+    // strings are stored escaped, so the output parses back
+    std::istringstream in(dump(json));
+    Parser parser(in);
+    Json parsed = parser.Parse();
+    EXPECT_EQ(parsed.Get("name")->Get<std::string>(), "a\\\"b");
+    EXPECT_EQ(parsed.Get("tags")->Get(1)->Get(0)->Get<double>(), 1);
+}
+
+TEST(BuilderTest, InsertOrUpdateTags) {
+    Json json = JsonBuilder<JsonType::jobject>();
+    json.InsertOrUpdate("b", true);
+    json.InsertOrUpdate("n", 1);
+    json.InsertOrUpdate("z", JNull{});
+    json.InsertOrUpdate("b", false);
+    EXPECT_EQ(json.Get("b")->type, JsonType::jbool);
+    EXPECT_EQ(json.Get("b")->Get<bool>(), false);
+    EXPECT_EQ(json.Get("n")->type, JsonType::jnumber);
+    EXPECT_EQ(json.Get("z")->type, JsonType::jnull);
+
+    EXPECT_EQ(JsonBuilder<JsonType::jnumber>().Get<double>(), 0);
+    EXPECT_EQ(JsonBuilder<JsonType::jbool>().Get<bool>(), false);
+}
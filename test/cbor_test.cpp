@@ -0,0 +1,75 @@
+#include "cbor.hpp"
+#include "json.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+TEST(CborTest, EncodeScalars) {
+    EXPECT_EQ(cbor::Encode(parseJSON("null")), "\xF6");
+    EXPECT_EQ(cbor::Encode(parseJSON("false")), "\xF4");
+    EXPECT_EQ(cbor::Encode(parseJSON("10")), "\x0A");
+    EXPECT_EQ(cbor::Encode(parseJSON("-1")), std::string("\x20"));
+    EXPECT_EQ(cbor::Encode(parseJSON("1000")), "\x19\x03\xE8");
+    EXPECT_EQ(cbor::Encode(parseJSON("-1000")), "\x39\x03\xE7");
+    EXPECT_EQ(cbor::Encode(parseJSON("1.5")),
+              std::string("\xFA\x3F\xC0\x00\x00", 5));
+    EXPECT_EQ(cbor::Encode(parseJSON("1.1")),
+              std::string("\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A", 9));
+    EXPECT_EQ(cbor::Encode(parseJSON(R"("a\tb")")), "\x63" "a\tb");
+    EXPECT_EQ(cbor::Encode(parseJSON("[1, [2]]")), "\x82\x01\x81\x02");
+}
+
+TEST(CborTest, DecodeRfcExamples) {
+    // half floats, tags, byte strings and indefinite lengths
+    EXPECT_EQ(cbor::Decode(std::string("\xF9\x3C\x00", 3)).Get<double>(), 1.0);
+    EXPECT_EQ(cbor::Decode(std::string("\xF9\xC4\x00", 3)).Get<double>(), -4.0);
+    EXPECT_EQ(cbor::Decode(std::string("\xF9\x00\x01", 3)).Get<double>(),
+              5.960464477539063e-8);
+    EXPECT_EQ(cbor::Decode("\xC1\x1A\x51\x4B\x67\xB0").Get<double>(),
+              1363896240);
+    EXPECT_EQ(cbor::Decode("\x44\x01\x02\x03\x04").Get<std::string>(),
+              R"(\u0001\u0002\u0003\u0004)");
+    EXPECT_EQ(cbor::Decode("\x7F\x65strea\x64ming\xFF").Get<std::string>(),
+              "streaming");
+    auto arr = cbor::Decode("\x9F\x01\x82\x02\x03\x9F\x04\x05\xFF\xFF");
+    EXPECT_EQ(arr.Size(), 3);
+    EXPECT_EQ(arr.Get(2).value().Get(1).value().Get<double>(), 5);
+    auto obj = cbor::Decode("\xBF\x61\x61\x01\x61\x62\x9F\x02\x03\xFF\xFF");
+    EXPECT_EQ(obj.Get("b").value().Get(1).value().Get<double>(), 3);
+    EXPECT_EQ(cbor::Decode("\xF7").type, JsonType::jnull);
+}
+
+TEST(CborTest, RoundTrip) {
+    auto json = parseJSON(R"({
+        "users": [
+            {"id": 1, "name": "Alice", "active": true, "tags": ["a", "b"]},
+            {"id": -70000, "name": "Zoë", "active": false, "score": 0.1}
+        ],
+        "metadata": {"version": null, "big": -5000000000}
+    })");
+    auto bytes = cbor::Encode(json);
+    auto copy = cbor::Decode(bytes);
+    EXPECT_EQ(cbor::Encode(copy).size(), bytes.size());
+    auto users = copy.Get("users").value();
+    EXPECT_EQ(users.Get(1).value().Get("name").value().Get<std::string>(),
+              "Zoë");
+    EXPECT_EQ(copy.Get("metadata").value().Get("big").value().Get<double>(),
+              -5000000000);
+}
+
+TEST(CborTest, InvalidInput) {
+    EXPECT_THROW(cbor::Decode(""), std::runtime_error);
+    EXPECT_THROW(cbor::Decode("\x82\x01"), std::runtime_error);
+    EXPECT_THROW(cbor::Decode("\xA1\x01\x01"), std::runtime_error);
+    EXPECT_THROW(cbor::Decode("\x9F\x01"), std::runtime_error);
+    EXPECT_THROW(cbor::Decode("\x1C"), std::runtime_error);
+    EXPECT_THROW(cbor::Decode("\x01\x01"), std::runtime_error);
+}
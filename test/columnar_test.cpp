@@ -0,0 +1,123 @@
+#include "columnar.hpp"
+#include <gtest/gtest.h>
+#include <limits>
+#include <sstream>
+
+using namespace sjp;
+
+static const std::vector<ColumnSpec> spec = {
+    {"ts", ColumnType::int64},
+    {"host", ColumnType::string},
+    {"lat", ColumnType::number},
+    {"ok", ColumnType::boolean}};
+
+static Table extract(std::string json_str) {
+    std::istringstream json(json_str);
+    return ExtractColumns(json, spec);
+}
+
+TEST(ColumnarTest, ExtractsColumns) {
+    Table table = extract(R"([
+        {"ts": 1, "host": "a", "lat": 0.5, "ok": true, "extra": [1, {}]},
+        {"host": "b\"c", "ts": -2, "lat": 1e3, "ok": false},
+        {"ts": null, "lat": 2}
+    ])");
+    ASSERT_EQ(table.rows, 3);
+    const Column &ts = table.columns[0];
+    EXPECT_EQ(ts.integers, (std::vector<int64_t>{1, -2, 0}));
+    EXPECT_TRUE(ts.IsValid(1));
+    EXPECT_FALSE(ts.IsValid(2));
+
+    const Column *host = table.Find("host");
+    ASSERT_NE(host, nullptr);
+    EXPECT_EQ(host->String(0), "a");
+    EXPECT_EQ(host->String(1), "b\"c");
+    EXPECT_EQ(host->String(2), "");
+    EXPECT_FALSE(host->IsValid(2));
+
+    EXPECT_EQ(table.Find("lat")->numbers, (std::vector<double>{0.5, 1000, 2}));
+    EXPECT_EQ(table.Find("ok")->booleans, (std::vector<uint8_t>{1, 0, 0}));
+    EXPECT_EQ(table.Find("missing"), nullptr);
+}
+
+TEST(ColumnarTest, ExactIntegers) {
+    Table table = extract(R"([{"ts": 9007199254740993},
+        {"ts": 1700000000123456789}, {"ts": -9223372036854775808},
+        {"ts": 1e3}, {"ts": 2.0}])");
+    EXPECT_EQ(table.columns[0].integers,
+              (std::vector<int64_t>{9007199254740993, 1700000000123456789,
+                                    std::numeric_limits<int64_t>::min(), 1000,
+                                    2}));
+    for (auto ts : {"9223372036854775808", "1e19", "9007199254740993.0",
+                    "1.5e0", "1e400"}) {
+        EXPECT_THROW(extract(std::string(R"([{"ts": )") + ts + "}]"),
+                     std::runtime_error)
+            << ts;
+    }
+    EXPECT_THROW(extract(R"([{"lat": 1e400}])"), std::runtime_error);
+}
+
+TEST(ColumnarTest, EmptyArray) {
+    EXPECT_EQ(extract("[]").rows, 0);
+    EXPECT_EQ(ExtractColumns(std::string_view(" [ ] "), spec, 4).rows, 0);
+}
+
+TEST(ColumnarTest, Errors) {
+    EXPECT_THROW(extract(R"({"ts": 1})"), std::runtime_error);
+    EXPECT_THROW(extract(R"([1])"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"ts": "x"}])"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"ts": 1.5}])"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"lat": [1]}])"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"ts": 1, "ts": 2}])"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"ts": 1},])"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"ts": 1}] x)"), std::runtime_error);
+    EXPECT_THROW(extract(R"([{"x": [1, 2})"), std::runtime_error);
+}
+
+TEST(ColumnarTest, ThreadedMatchesSequential) {
+    std::string json = "[";
+    for (int i = 0; i < 1000; ++i) {
+        if (i) {
+            json += ",";
+        }
+        json += "{\"ts\": " + std::to_string(i);
+        if (i % 3) {
+            json += ", \"host\": \"h" + std::to_string(i) + "\\n\"";
+        }
+        if (i % 7) {
+            json += ", \"skip\": {\"a\": \"]}\", \"b\": [[]]}";
+        }
+        json += ", \"lat\": " + std::to_string(i) + ".25}";
+    }
+    json += "]";
+
+    Table expected = extract(json);
+    for (unsigned threads : {2u, 3u, 8u}) {
+        Table table = ExtractColumns(std::string_view(json), spec, threads);
+        ASSERT_EQ(table.rows, expected.rows);
+        for (size_t i = 0; i < spec.size(); ++i) {
+            const Column &a = table.columns[i];
+            const Column &b = expected.columns[i];
+            EXPECT_EQ(a.size, b.size);
+            EXPECT_EQ(a.integers, b.integers);
+            EXPECT_EQ(a.numbers, b.numbers);
+            EXPECT_EQ(a.booleans, b.booleans);
+            EXPECT_EQ(a.offsets, b.offsets);
+            EXPECT_EQ(a.chars, b.chars);
+            EXPECT_EQ(a.validity, b.validity);
+        }
+    }
+    EXPECT_EQ(expected.Find("host")->String(2), "h2\n");
+}
+
+TEST(ColumnarTest, ThreadedErrors) {
+    EXPECT_THROW(ExtractColumns(std::string_view(R"([{"ts": 1},,{}])"), spec,
+                                4),
+                 std::runtime_error);
+    EXPECT_THROW(ExtractColumns(std::string_view(R"([{"ts": 1}, {"ts": 2})"),
+                                spec, 4),
+                 std::runtime_error);
+    EXPECT_THROW(ExtractColumns(std::string_view(R"([{"ts": 1}, {"ts": "x"}])"),
+                                spec, 2),
+                 std::runtime_error);
+}
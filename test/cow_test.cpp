@@ -0,0 +1,63 @@
+#include "cow.hpp"
+#include "json.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+TEST(CowTest, CopiesAreIndependent) {
+    CowJson base(parseJSON(R"({"a": {"b": 1}, "c": [1, 2]})"));
+    CowJson copy = base;
+    copy.Set({"a", "b"}, 2);
+    copy.Set({"c", Json::end}, 3);
+    copy.Set({"d"}, "new");
+    EXPECT_EQ(base.Get({"a", "b"}).value().Get<double>(), 1);
+    EXPECT_EQ(base.Get({"c"}).value().Size(), 2);
+    EXPECT_EQ(base.Get({"d"}), std::nullopt);
+    EXPECT_EQ(copy.Get({"a", "b"}).value().Get<double>(), 2);
+    EXPECT_EQ(copy.Get({"c", 2}).value().Get<double>(), 3);
+    EXPECT_EQ(copy.Get({"d"}).value().Get<std::string>(), "new");
+}
+
+TEST(CowTest, UntouchedSubtreesAreShared) {
+    CowJson base(parseJSON(R"({"a": {"b": 1}, "big": [[1], {"x": true}]})"));
+    CowJson copy = base;
+    copy.Set({"a", "b"}, false);
+    EXPECT_NE(base.Root().value, copy.Root().value);
+    EXPECT_NE(base.Get({"a"}).value().value, copy.Get({"a"}).value().value);
+    EXPECT_EQ(base.Get({"big"}).value().value,
+              copy.Get({"big"}).value().value);
+}
+
+TEST(CowTest, UniqueNodesAreMutatedInPlace) {
+    CowJson doc(parseJSON(R"({"a": {"b": 1}})"));
+    auto *node = doc.Root().value.get();
+    doc.Set({"a", "b"}, 2);
+    doc.Set({"a", "c"}, JNull{});
+    EXPECT_EQ(doc.Root().value.get(), node);
+    EXPECT_EQ(doc.Get({"a"}).value().Size(), 2);
+}
+
+TEST(CowTest, ReplaceRootAndNestedJson) {
+    CowJson doc(parseJSON("[]"));
+    CowJson copy = doc;
+    copy.Set({}, parseJSON(R"({"list": []})"));
+    copy.Set({"list", Json::end}, parseJSON(R"({"k": "v"})"));
+    EXPECT_EQ(doc.Root().type, JsonType::jarray);
+    EXPECT_EQ(copy.Get({"list", 0, "k"}).value().Get<std::string>(), "v");
+}
+
+TEST(CowTest, InvalidPath) {
+    CowJson doc(parseJSON(R"({"a": [1]})"));
+    EXPECT_THROW(doc.Set({"missing", "b"}, 1), std::runtime_error);
+    EXPECT_THROW(doc.Set({"a", "b"}, 1), std::runtime_error);
+    EXPECT_THROW(doc.Set({0}, 1), std::runtime_error);
+    EXPECT_EQ(doc.Get({"a", 5}), std::nullopt);
+}
@@ -0,0 +1,146 @@
+#include "decompress.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <iterator>
+#include <sstream>
+#include <zlib.h>
+#ifdef SJP_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace sjp;
+
+// format is 16 + 15 for gzip, 15 for zlib
+static std::string deflate(const std::string &data, int bits = 16 + 15) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, bits, 8,
+                 Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())),
+                    '\0');
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+#ifdef SJP_WITH_ZSTD
+static std::string zstd(const std::string &data) {
+    std::string out(ZSTD_compressBound(data.size()), '\0');
+    size_t size =
+        ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 1);
+    out.resize(size);
+    return out;
+}
+#endif
+
+static std::string document(size_t records) {
+    std::string json = "[";
+    for (size_t i = 0; i < records; ++i) {
+        json += (i ? "," : "") + std::string(R"({"id": )") +
+                std::to_string(i) + R"(, "level": "INFO"})";
+    }
+    return json + "]";
+}
+
+static std::string decompress(const std::string &compressed,
+                              size_t chunk_size, size_t chunks) {
+    std::istringstream in(compressed);
+    DecompressStream stream(in, DecompressStream::Codec::automatic,
+                            chunk_size, chunks);
+    return std::string(std::istreambuf_iterator<char>(stream), {});
+}
+
+TEST(DecompressTest, ParsesGzip) {
+    std::string json = document(5000);
+    std::istringstream in(deflate(json));
+    // far smaller than the document, the ring wraps many times
+    DecompressStream stream(in, DecompressStream::Codec::automatic, 64, 2);
+    Parser parser(stream);
+    Json result = parser.Parse();
+    ASSERT_EQ(result.Size(), 5000);
+    EXPECT_EQ(result.Get(4999)->Get("id")->Get<double>(), 4999);
+}
+
+TEST(DecompressTest, ChunkBoundaries) {
+    std::string json = document(100);
+    for (size_t chunk_size : {1, 7, 64, 4096, 1 << 20}) {
+        EXPECT_EQ(decompress(deflate(json), chunk_size, 3), json)
+            << chunk_size;
+    }
+    EXPECT_EQ(decompress(deflate(json, 15), 16, 1), json);
+    EXPECT_EQ(decompress(deflate(""), 16, 1), "");
+}
+
+TEST(DecompressTest, ConcatenatedMembers) {
+    std::string compressed = deflate("[1, ") + deflate("2]");
+    std::istringstream in(compressed);
+    DecompressStream stream(in);
+    Parser parser(stream);
+    EXPECT_EQ(parser.Parse().Get(1)->Get<double>(), 2);
+}
+
+TEST(DecompressTest, CorruptInputThrows) {
+    std::string compressed = deflate(document(1000));
+    std::string truncated = compressed.substr(0, compressed.size() / 2);
+    std::istringstream in(truncated);
+    DecompressStream stream(in);
+    // the tokenizer already reads ahead on construction
+    EXPECT_THROW(Parser(stream).Parse(), std::runtime_error);
+
+    std::string garbage = compressed;
+    garbage[20] = static_cast<char>(garbage[20] ^ 0xff);
+    garbage[21] = static_cast<char>(garbage[21] ^ 0xff);
+    EXPECT_THROW(decompress(garbage, 64, 2), std::runtime_error);
+    EXPECT_THROW(decompress("not compressed at all", 64, 2),
+                 std::runtime_error);
+}
+
+TEST(DecompressTest, StopsEarly) {
+    // the reader stops after the first value while the producer is still
+    // waiting for a free chunk
+    std::string json = "1 " + document(10000);
+    std::istringstream in(deflate(json));
+    DecompressStream stream(in, DecompressStream::Codec::automatic, 32, 2);
+    int first = 0;
+    stream >> first;
+    EXPECT_EQ(first, 1);
+}
+
+#ifdef SJP_WITH_ZSTD
+TEST(DecompressTest, ParsesZstd) {
+    std::string json = document(5000);
+    std::istringstream in(zstd(json));
+    DecompressStream stream(in, DecompressStream::Codec::automatic, 64, 2);
+    Parser parser(stream);
+    Json result = parser.Parse();
+    ASSERT_EQ(result.Size(), 5000);
+    EXPECT_EQ(result.Get(4999)->Get("id")->Get<double>(), 4999);
+    for (size_t chunk_size : {1, 7, 4096}) {
+        EXPECT_EQ(decompress(zstd(json), chunk_size, 3), json) << chunk_size;
+    }
+    std::string compressed = zstd(json);
+    EXPECT_THROW(decompress(compressed.substr(0, compressed.size() / 2), 64,
+                            2),
+                 std::runtime_error);
+}
+#else
+TEST(DecompressTest, ZstdNeedsOption) {
+    // a zstd frame header, rejected before any decoding
+    std::string frame = "\x28\xb5\x2f\xfd\x00\x00";
+    EXPECT_THROW(decompress(frame, 64, 2), std::runtime_error);
+    std::istringstream in(frame);
+    DecompressStream stream(in);
+    EXPECT_THROW(Parser(stream).Parse(), std::runtime_error);
+    try {
+        decompress(frame, 64, 2);
+    } catch (const std::runtime_error &e) {
+        EXPECT_NE(std::string(e.what()).find("SJP_WITH_ZSTD"),
+                  std::string::npos);
+    }
+}
+#endif
@@ -0,0 +1,127 @@
+#include "describe.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+namespace rpc {
+struct Address {
+    std::string city;
+    int zip = 0;
+};
+SJP_DESCRIBE(Address, city, zip)
+
+struct User {
+    std::string name;
+    double score = 0;
+    bool active = false;
+    std::vector<int> ids;
+    std::optional<Address> address;
+};
+SJP_DESCRIBE(User, name, score, active, ids, address)
+} // namespace rpc
+
+template <typename T> T deserialize(std::string json_str) {
+    std::istringstream json(json_str);
+    return Deserialize<T>(json);
+}
+
+TEST(DescribeTest, SimpleStruct) {
+    auto address = deserialize<rpc::Address>(R"({"city": "Paris", "zip": 75})");
+    EXPECT_EQ(address.city, "Paris");
+    EXPECT_EQ(address.zip, 75);
+}
+
+TEST(DescribeTest, NestedStruct) {
+    auto user = deserialize<rpc::User>(R"({
+        "name": "Alice",
+        "score": 4.5,
+        "active": true,
+        "ids": [1, 2, 3],
+        "address": {"zip": 10, "city": "Oslo"}
+    })");
+    EXPECT_EQ(user.name, "Alice");
+    EXPECT_EQ(user.score, 4.5);
+    EXPECT_TRUE(user.active);
+    EXPECT_EQ(user.ids, (std::vector<int>{1, 2, 3}));
+    ASSERT_TRUE(user.address.has_value());
+    EXPECT_EQ(user.address->city, "Oslo");
+    EXPECT_EQ(user.address->zip, 10);
+}
+
+TEST(DescribeTest, NullOptionalAndMissingFields) {
+    auto user = deserialize<rpc::User>(R"({"address": null, "name": "Bob"})");
+    EXPECT_EQ(user.name, "Bob");
+    EXPECT_EQ(user.score, 0);
+    EXPECT_FALSE(user.address.has_value());
+}
+
+TEST(DescribeTest, UnknownKeysAreSkipped) {
+    auto address = deserialize<rpc::Address>(R"({
+        "extra": {"a": [1, {"b": "}]"}], /* ] */ "c": null},
+        "city": "Rome",
+        "more": [[], {}],
+        "zip": 1
+    })");
+    EXPECT_EQ(address.city, "Rome");
+    EXPECT_EQ(address.zip, 1);
+}
+
+TEST(DescribeTest, EscapedStrings) {
+    auto address =
+        deserialize<rpc::Address>(R"({"city": "a\"b\\cé😊"})");
+    EXPECT_EQ(address.city, "a\"b\\cé\U0001F60A");
+}
+
+TEST(DescribeTest, TypeMismatch) {
+    EXPECT_THROW(deserialize<rpc::Address>(R"({"city": 42})"),
+                 std::runtime_error);
+    EXPECT_THROW(deserialize<rpc::Address>(R"({"zip": 1.5})"),
+                 std::runtime_error);
+    EXPECT_THROW(deserialize<rpc::Address>(R"({"zip": "1"})"),
+                 std::runtime_error);
+}
+
+TEST(DescribeTest, InvalidJson) {
+    EXPECT_THROW(deserialize<rpc::Address>(R"({"city": "Rome",})"),
+                 std::runtime_error);
+    EXPECT_THROW(deserialize<rpc::Address>(R"({"extra": [1, 2)"),
+                 std::runtime_error);
+    EXPECT_THROW(deserialize<rpc::Address>(R"({"city": "Rome"} 1)"),
+                 std::runtime_error);
+}
+
+TEST(DescribeTest, SerializeStruct) {
+    rpc::User user{.name = "Alice",
+                   .score = 0.1,
+                   .active = true,
+                   .ids = {1, 2},
+                   .address = rpc::Address{.city = "Oslo", .zip = 10}};
+    EXPECT_EQ(Serialize(user),
+              R"({"name":"Alice","score":0.1,"active":true,"ids":[1,2],)"
+              R"("address":{"city":"Oslo","zip":10}})");
+}
+
+TEST(DescribeTest, SerializeEscapesAndNulls) {
+    rpc::User user;
+    user.name = "a\"b\\c\n\x01";
+    user.score = 1e300;
+    EXPECT_EQ(Serialize(user),
+              R"({"name":"a\"b\\c\n\u0001","score":1e+300,"active":false,)"
+              R"("ids":[],"address":null})");
+}
+
+TEST(DescribeTest, SerializeRoundTrip) {
+    rpc::User user{.name = "Zoë \"Z\"",
+                   .score = -2.5e-7,
+                   .ids = {-3, 0, 7},
+                   .address = rpc::Address{.city = "\t", .zip = -1}};
+    std::string out = "prefix";
+    Serialize(user, out);
+    auto copy = deserialize<rpc::User>(out.substr(6));
+    EXPECT_EQ(copy.name, user.name);
+    EXPECT_EQ(copy.score, user.score);
+    EXPECT_EQ(copy.ids, user.ids);
+    EXPECT_EQ(copy.address->city, "\t");
+    EXPECT_EQ(copy.address->zip, -1);
+}
@@ -0,0 +1,109 @@
+#include "parser.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str, ParserOptions options = {}) {
+    std::istringstream json(json_str);
+    Parser parser(json, options);
+    return parser.Parse();
+}
+
+static std::string dump(const Json &json) {
+    std::ostringstream out;
+    json.Dump(out);
+    return out.str();
+}
+
+static std::string parallelDump(const Json &json, unsigned threads,
+                                size_t grain) {
+    std::ostringstream out;
+    json.ParallelDump(out, threads, grain);
+    return out.str();
+}
+
+static std::string document() {
+    std::string json = R"({"meta": {"name": "x\"y", "ok": true}, "rows": [)";
+    for (int i = 0; i < 200; ++i) {
+        std::string n = std::to_string(i);
+        json += i ? ", " : "";
+        json += R"({"id": )" + n + R"(, "v": [)" + n + ", " + n +
+                R"(.5], "f": null})";
+    }
+    json += R"(], "packed": [)";
+    for (int i = 0; i < 300; ++i) {
+        json += i ? ", " : "";
+        json += std::to_string(i) + ".25";
+    }
+    json += R"(], "bools": [true, false, true], "empty": [], "obj": {}})";
+    return json;
+}
+
+TEST(DumpTest, MatchesDump) {
+    Json json = parseJSON(document());
+    std::string expected = dump(json);
+    for (unsigned threads : {1u, 2u, 4u}) {
+        for (size_t grain : {1u, 2u, 7u, 64u, 100000u}) {
+            EXPECT_EQ(parallelDump(json, threads, grain), expected)
+                << threads << " threads, grain " << grain;
+        }
+    }
+}
+
+TEST(DumpTest, Scalars) {
+    for (auto str : {"1.5", "\"a\"", "null", "[]", "{}", "[[[1]]]"}) {
+        Json json = parseJSON(str);
+        EXPECT_EQ(parallelDump(json, 4, 1), dump(json)) << str;
+    }
+}
+
+TEST(DumpTest, LazyNumbers) {
+    Json json = parseJSON(document(), {.lazy_numbers = true});
+    EXPECT_EQ(parallelDump(json, 3, 5), dump(json));
+}
+
+TEST(DumpTest, StreamFormatting) {
+    Json json = parseJSON(document());
+    std::ostringstream expected;
+    expected << std::setprecision(3) << std::scientific << std::setw(5);
+    json.Dump(expected);
+    std::ostringstream out;
+    out << std::setprecision(3) << std::scientific << std::setw(5);
+    json.ParallelDump(out, 4, 3);
+    EXPECT_EQ(out.str(), expected.str());
+    EXPECT_EQ(out.width(), expected.width());
+}
+
+// Accepts limit bytes, then fails every write.
+class FailingBuf : public std::streambuf {
+  public:
+    explicit FailingBuf(size_t limit) : limit(limit) {}
+
+  protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+        size_t n = std::min(limit, static_cast<size_t>(count));
+        limit -= n;
+        return static_cast<std::streamsize>(n);
+    }
+    int_type overflow(int_type) override { return traits_type::eof(); }
+
+  private:
+    size_t limit;
+};
+
+TEST(DumpTest, WriteErrors) {
+    Json json = parseJSON(document());
+    FailingBuf buf(1000);
+    std::ostream out(&buf);
+    out.exceptions(std::ios::badbit);
+    EXPECT_THROW(json.ParallelDump(out, 4, 2), std::ios::failure);
+
+    // without exceptions the stream just goes bad, like with Dump
+    FailingBuf quiet(1000);
+    std::ostream silent(&quiet);
+    json.ParallelDump(silent, 4, 2);
+    EXPECT_TRUE(silent.bad());
+}
@@ -0,0 +1,154 @@
+#include "builder.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str, ParserOptions options = {}) {
+    std::istringstream json(json_str);
+    Parser parser(json, options);
+    return parser.Parse();
+}
+
+TEST(HashTest, KeyOrderIndependent) {
+    Json a = parseJSON(R"({"a": 1, "b": [true, null], "c": {"x": "y"}})");
+    Json b = parseJSON(R"({"c": {"x": "y"}, "b": [true, null], "a": 1})");
+    EXPECT_EQ(a.Hash(), b.Hash());
+    EXPECT_TRUE(a == b);
+    EXPECT_EQ(std::hash<Json>{}(a), std::hash<Json>{}(b));
+}
+
+TEST(HashTest, Unequal) {
+    Json base = parseJSON(R"({"a": [1, 2, 3], "b": "x"})");
+    for (auto other : {R"({"a": [1, 2, 4], "b": "x"})",
+                       R"({"a": [1, 2, 3], "b": "y"})",
+                       R"({"a": [1, 2, 3], "c": "x"})",
+                       R"({"a": [1, 2, 3]})", R"({"a": [3, 2, 1], "b": "x"})",
+                       R"([1, 2, 3])"}) {
+        Json json = parseJSON(other);
+        EXPECT_FALSE(base == json) << other;
+        EXPECT_NE(base.Hash(), json.Hash()) << other;
+    }
+    EXPECT_FALSE(parseJSON("[1, 0]") == parseJSON("[true, false]"));
+    EXPECT_FALSE(parseJSON("[1, 0]") == parseJSON("[1, null]"));
+    EXPECT_FALSE(parseJSON("\"1\"") == parseJSON("1"));
+}
+
+TEST(HashTest, PackedAndGenericAgree) {
+    Json packed = parseJSON("[1, 2.5, -0]");
+    Json generic = MakeArray(ToJson(1), ToJson(2.5), ToJson(0));
+    Json lazy = parseJSON("[1, 2.5, 0]", {.lazy_numbers = true});
+    EXPECT_EQ(packed.Hash(), generic.Hash());
+    EXPECT_EQ(packed.Hash(), lazy.Hash());
+    EXPECT_TRUE(packed == generic);
+    EXPECT_TRUE(generic == packed);
+    EXPECT_TRUE(lazy == packed);
+}
+
+TEST(HashTest, MutationInvalidates) {
+    Json json = parseJSON(R"({"users": [{"id": 1}, {"id": 2}]})");
+    Json copy = parseJSON(R"({"users": [{"id": 1}, {"id": 2}]})");
+    uint64_t before = json.Hash();
+    EXPECT_EQ(before, copy.Hash());
+
+    // a nested node shared with json, the root never sees the call
+    Json user = *json.Get("users")->Get(1);
+    user.InsertOrUpdate("id", 3);
+    EXPECT_NE(json.Hash(), before);
+    EXPECT_FALSE(json == copy);
+
+    user.InsertOrUpdate("id", 2);
+    EXPECT_EQ(json.Hash(), before);
+    EXPECT_TRUE(json == copy);
+
+    json.Get("users")->AppendOrUpdate(Json::end, JNull{});
+    EXPECT_FALSE(json == copy);
+}
+
+TEST(HashTest, UnrelatedMutationKeepsCache) {
+    Json json = parseJSON(R"({"a": [1, {"b": 2}], "c": {"d": [true]}})");
+    Json other = parseJSON(R"({"a": [1, {"b": 2}]})");
+    json.Hash();
+    other.Get("a")->AppendOrUpdate(Json::end, 3);
+    other.InsertOrUpdate("e", 4);
+    EXPECT_NE(json.value->Cache()->hash.load(), 0u);
+
+    // only the path from the change up is cleared
+    json.Get("a")->Get(1)->InsertOrUpdate("b", 5);
+    EXPECT_EQ(json.value->Cache()->hash.load(), 0u);
+    EXPECT_NE(json.Get("c")->value->Cache()->hash.load(), 0u);
+}
+
+TEST(HashTest, SharedNodes) {
+    Json shared = parseJSON(R"({"x": [1]})");
+    Json array = MakeArray(shared, 1);
+    Json object = MakeObject({{"k", shared}});
+    uint64_t array_hash = array.Hash();
+    uint64_t object_hash = object.Hash();
+    shared.Get("x")->AppendOrUpdate(Json::end, 2);
+    EXPECT_NE(array.Hash(), array_hash);
+    EXPECT_NE(object.Hash(), object_hash);
+    EXPECT_TRUE(*array.Get(0) == *object.Get("k"));
+
+    // a shallow clone shares its children with the original
+    Json clone{.type = JsonType::jobject, .value = object.value->Clone()};
+    EXPECT_TRUE(clone == object);
+    shared.InsertOrUpdate("y", 3);
+    EXPECT_TRUE(clone == object);
+    EXPECT_NE(object.Hash(), object_hash);
+}
+
+TEST(HashTest, ConcurrentReaders) {
+    std::string items;
+    for (int i = 0; i < 1000; ++i) {
+        items += (i ? ", " : "") + std::string(R"({"n": )") +
+                 std::to_string(i) + "}";
+    }
+    for (bool lazy : {false, true}) {
+        Json json = parseJSON("[" + items + "]", {.lazy_numbers = lazy});
+        Json copy = parseJSON("[" + items + "]");
+        std::vector<std::thread> threads;
+        std::vector<uint64_t> hashes(4);
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            threads.emplace_back([&, i] {
+                hashes[i] = json.Hash();
+                EXPECT_TRUE(json == copy);
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (uint64_t hash : hashes) {
+            EXPECT_EQ(hash, copy.Hash()) << lazy;
+        }
+    }
+}
+
+TEST(HashTest, ConcurrentSharedNodes) {
+    // two parents of one container hashed at once for the first time must
+    // not keep a hash that mutations below no longer reach
+    Json expected = MakeArray(parseJSON(R"({"x": [1], "y": 3})"));
+    for (int i = 0; i < 200; ++i) {
+        Json shared = parseJSON(R"({"x": [1]})");
+        Json first = MakeArray(shared);
+        Json second = MakeArray(shared);
+        std::thread thread([&] { second.Hash(); });
+        first.Hash();
+        thread.join();
+        shared.InsertOrUpdate("y", 3);
+        ASSERT_EQ(first.Hash(), expected.Hash()) << i;
+        ASSERT_EQ(second.Hash(), expected.Hash()) << i;
+    }
+}
+
+TEST(HashTest, CacheKey) {
+    std::unordered_set<Json> seen;
+    seen.insert(parseJSON(R"({"a": 1, "b": 2})"));
+    seen.insert(parseJSON(R"({"b": 2, "a": 1})"));
+    seen.insert(parseJSON(R"({"a": 1})"));
+    EXPECT_EQ(seen.size(), 2);
+    EXPECT_TRUE(seen.contains(MakeObject({{"a", 1}})));
+}
@@ -0,0 +1,116 @@
+#include "builder.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str, ParserOptions options = {}) {
+    std::istringstream json(json_str);
+    Parser parser(json, options);
+    return parser.Parse();
+}
+
+static Expected<Json> tryParse(std::string json_str, ParserOptions options) {
+    std::istringstream json(json_str);
+    Parser parser(json, options);
+    return parser.TryParse();
+}
+
+static const std::string document =
+    R"({"name": ")" + std::string(100, 'x') +
+    R"(", "nums": [1, 2, 3], "flags": [true], "list": [{"a": null}, "s"]})";
+
+TEST(MemoryTest, Breakdown) {
+    Json json = parseJSON(document);
+    MemoryUsage usage = json.MemoryUsage();
+    EXPECT_GE(usage.strings, 101u);
+    EXPECT_GE(usage.arrays, 3 * sizeof(double) + 2 * sizeof(Json));
+    EXPECT_GE(usage.object_nodes, 5 * sizeof(Json));
+    EXPECT_GT(usage.buckets, 0u);
+    // 2 objects, 3 arrays, 2 strings and a null
+    size_t block = parseJSON("null").NodeMemoryUsage().control_blocks;
+    EXPECT_EQ(usage.control_blocks, 8 * block);
+    EXPECT_GE(usage.nodes, 2 * sizeof(JsonObject) + 3 * sizeof(JsonArray));
+    EXPECT_EQ(usage.Total(), usage.nodes + usage.control_blocks +
+                                 usage.strings + usage.arrays +
+                                 usage.object_nodes + usage.buckets);
+}
+
+TEST(MemoryTest, NodeExcludesChildren) {
+    Json json = parseJSON(document);
+    MemoryUsage node = json.NodeMemoryUsage();
+    EXPECT_EQ(node.nodes, sizeof(JsonObject));
+    EXPECT_EQ(node.arrays, 0u);
+    EXPECT_LT(node.Total(), json.MemoryUsage().Total());
+
+    Json str = parseJSON("\"short\"");
+    EXPECT_EQ(str.NodeMemoryUsage().strings, 0u);
+    EXPECT_EQ(str.MemoryUsage().Total(), str.NodeMemoryUsage().Total());
+}
+
+TEST(MemoryTest, SharedNodesCountedOnce) {
+    Json item = MakeArray(std::string(64, 'y'), 1);
+    Json shared = MakeArray(item, item);
+    Json copies = MakeArray(item, MakeArray(std::string(64, 'y'), 1));
+    EXPECT_EQ(shared.MemoryUsage().Total() + item.MemoryUsage().Total(),
+              copies.MemoryUsage().Total());
+}
+
+TEST(MemoryTest, ParserLimit) {
+    size_t total = parseJSON(document).MemoryUsage().Total();
+    EXPECT_TRUE(tryParse(document, {.max_allocation = total}));
+    auto json = tryParse(document, {.max_allocation = total - 1});
+    ASSERT_FALSE(json);
+    EXPECT_EQ(json.error().code, ParseErrorCode::memory_limit);
+    EXPECT_THROW(parseJSON(document, {.max_allocation = 64}),
+                 std::runtime_error);
+}
+
+TEST(MemoryTest, ParserStopsEarly) {
+    for (auto element : {"1", "true", "\"s\"", "[]"}) {
+        std::string json = "[";
+        for (int i = 0; i < 100000; ++i) {
+            json += i ? ", " : "";
+            json += element;
+        }
+        json += "]";
+        auto result = tryParse(json, {.max_allocation = 1024});
+        ASSERT_FALSE(result) << element;
+        EXPECT_EQ(result.error().code, ParseErrorCode::memory_limit);
+        EXPECT_LT(result.error().offset, json.size() / 4) << element;
+    }
+}
+
+TEST(MemoryTest, ParserStopsEarlyInObjects) {
+    std::string json = "{";
+    for (int i = 0; i < 1000; ++i) {
+        json += i ? ", " : "";
+        json += "\"" + std::to_string(i) + std::string(1000, 'k') + "\": null";
+    }
+    json += "}";
+    auto result = tryParse(json, {.max_allocation = 64 << 10});
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, ParseErrorCode::memory_limit);
+    EXPECT_LT(result.error().offset, json.size() / 4);
+
+    // packed elements promoted to nodes are counted too
+    std::string mixed = "[1, 2, 3, \"s\"]";
+    size_t total = parseJSON(mixed).MemoryUsage().Total();
+    EXPECT_TRUE(tryParse(mixed, {.max_allocation = total}));
+    EXPECT_FALSE(tryParse(mixed, {.max_allocation = total - 1}));
+}
+
+TEST(MemoryTest, ParserStopsInLongLexemes) {
+    for (std::string json : {"[\"" + std::string(1 << 20, 's') + "\"]",
+                             "[1" + std::string(1 << 20, '0') + "]"}) {
+        std::istringstream in(json);
+        Parser parser(in, {.max_allocation = 64 << 10});
+        auto result = parser.TryParse();
+        ASSERT_FALSE(result);
+        EXPECT_EQ(result.error().code, ParseErrorCode::memory_limit);
+        EXPECT_EQ(result.error().offset, 1u);
+        // the rest of the lexeme is left unread
+        EXPECT_LT(static_cast<size_t>(in.tellg()), json.size() / 4);
+    }
+}
@@ -0,0 +1,77 @@
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+static std::string dump(const Json &json) {
+    std::ostringstream out;
+    json.Dump(out);
+    return out.str();
+}
+
+TEST(MsgpackTest, EncodeScalars) {
+    EXPECT_EQ(msgpack::Encode(parseJSON("null")), "\xC0");
+    EXPECT_EQ(msgpack::Encode(parseJSON("true")), "\xC3");
+    EXPECT_EQ(msgpack::Encode(parseJSON("7")), "\x07");
+    EXPECT_EQ(msgpack::Encode(parseJSON("-1")), "\xFF");
+    EXPECT_EQ(msgpack::Encode(parseJSON("300")), "\xCD\x01\x2C");
+    EXPECT_EQ(msgpack::Encode(parseJSON("-200")), std::string("\xD1\xFF\x38"));
+    EXPECT_EQ(msgpack::Encode(parseJSON("1.5")),
+              std::string("\xCA\x3F\xC0\x00\x00", 5));
+    EXPECT_EQ(msgpack::Encode(parseJSON("0.1")).size(), 9);
+    EXPECT_EQ(msgpack::Encode(parseJSON(R"("abc")")), "\xA3" "abc");
+}
+
+TEST(MsgpackTest, EncodeUnescapesStrings) {
+    EXPECT_EQ(msgpack::Encode(parseJSON(R"("a\"b\n")")), "\xA4" "a\"b\n");
+}
+
+TEST(MsgpackTest, RoundTrip) {
+    auto json = parseJSON(R"({
+        "users": [
+            {"id": 1, "name": "Alice \"A\"", "active": true},
+            {"id": -70000, "name": "Bob", "active": false, "score": 0.1}
+        ],
+        "metadata": {"version": null, "tags": [], "big": 5000000000}
+    })");
+    auto bytes = msgpack::Encode(json);
+    auto copy = msgpack::Decode(bytes);
+    EXPECT_EQ(msgpack::Encode(copy).size(), bytes.size());
+    auto users = copy.Get("users").value();
+    EXPECT_EQ(users.Get(0).value().Get("name").value().Get<std::string>(),
+              R"(Alice \"A\")");
+    EXPECT_EQ(users.Get(1).value().Get("id").value().Get<double>(), -70000);
+    EXPECT_EQ(copy.Get("metadata").value().Get("big").value().Get<double>(),
+              5000000000);
+    EXPECT_EQ(dump(copy.Get("metadata").value().Get("tags").value()), "[]");
+}
+
+TEST(MsgpackTest, LargeContainers) {
+    std::string data("[");
+    for (int i = 0; i < 70000; ++i) {
+        data += std::to_string(i) + ",";
+    }
+    data.back() = ']';
+    auto bytes = msgpack::Encode(parseJSON(data));
+    EXPECT_EQ(bytes.substr(0, 5), std::string("\xDD\x00\x01\x11\x70", 5));
+    auto copy = msgpack::Decode(bytes);
+    EXPECT_EQ(copy.Size(), 70000);
+    EXPECT_EQ(copy.Get(69999).value().Get<double>(), 69999);
+}
+
+TEST(MsgpackTest, InvalidInput) {
+    EXPECT_THROW(msgpack::Decode(""), std::runtime_error);
+    EXPECT_THROW(msgpack::Decode("\x92\x01"), std::runtime_error);
+    EXPECT_THROW(msgpack::Decode("\x81\x01\x01"), std::runtime_error);
+    EXPECT_THROW(msgpack::Decode("\xC0\xC0"), std::runtime_error);
+    EXPECT_THROW(msgpack::Decode("\xD4\x01\x01"), std::runtime_error);
+}
@@ -485,3 +485,284 @@ TEST(JsonParserTest, ModifyArrayToObject) {
     json.InsertOrUpdate("1", 1);
     EXPECT_EQ(json.Size(), 2);
 }
+
+/*
+ * Test TryParse
+ */
+
+Expected<Json> tryParseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.TryParse();
+}
+
+TEST(JsonParserTest, TryParseValid) {
+    auto result = tryParseJSON(R"({"key": [1, "two", null]})");
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->Get("key").value().Get(1).value().Get<std::string>(),
+              "two");
+}
+
+TEST(JsonParserTest, TryParseReportsPosition) {
+    auto result = tryParseJSON("{\n  \"a\": 1,\n  \"b\" 2\n}");
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, ParseErrorCode::unexpected_token);
+    EXPECT_EQ(result.error().offset, 18);
+    EXPECT_EQ(result.error().line, 3);
+    EXPECT_EQ(result.error().column, 7);
+}
+
+TEST(JsonParserTest, TryParseErrorCodes) {
+    EXPECT_EQ(tryParseJSON(R"({"number": 1e9999})").error().code,
+              ParseErrorCode::number_out_of_range);
+    EXPECT_EQ(tryParseJSON(R"({"key": invalid})").error().code,
+              ParseErrorCode::invalid_number);
+    EXPECT_EQ(tryParseJSON(R"({"key": "value)").error().code,
+              ParseErrorCode::unexpected_end);
+    EXPECT_EQ(tryParseJSON(R"({"key": "value")").error().code,
+              ParseErrorCode::unexpected_end);
+    EXPECT_EQ(tryParseJSON(R"({"a": 1, "a": 2})").error().code,
+              ParseErrorCode::duplicate_key);
+    EXPECT_EQ(tryParseJSON("[1] /* open").error().code,
+              ParseErrorCode::invalid_comment);
+    EXPECT_EQ(tryParseJSON("[1] 2").error().code,
+              ParseErrorCode::unexpected_token);
+    EXPECT_EQ(tryParseJSON("   ").error().code,
+              ParseErrorCode::unexpected_end);
+}
+
+TEST(JsonParserTest, TryParseValueThrowsOnError) {
+    auto result = tryParseJSON("[1,]");
+    EXPECT_THROW(result.value(), std::runtime_error);
+}
+
+/*
+ * Test projection
+ */
+static Json parseProjected(std::string json_str, const Projection &fields) {
+    std::istringstream json(json_str);
+    Parser parser(json, {.projection = &fields});
+    return parser.Parse();
+}
+
+TEST(JsonParserTest, ProjectionKeepsOnlyListedFields) {
+    Projection fields{"/meta/host", "/cpu"};
+    Json json = parseProjected(
+        R"({"meta": {"host": "a", "pid": 1}, "cpu": [1, {"x": 2}],
+            "mem": {"deep": [[{"}": "]"}]]}, "tag": "x"})",
+        fields);
+    EXPECT_EQ(json.Size(), 2);
+    EXPECT_EQ(json.Get("meta")->Size(), 1);
+    EXPECT_EQ(json.Get("meta")->Get("host")->Get<std::string>(), "a");
+    EXPECT_EQ(json.Get("cpu")->Get(1)->Get("x")->Get<double>(), 2);
+    EXPECT_EQ(json.Get("mem"), std::nullopt);
+}
+
+TEST(JsonParserTest, ProjectionAppliesToArrayElements) {
+    Projection fields{"/events/id"};
+    Json json = parseProjected(
+        R"({"events": [{"id": 1, "body": "x"}, {"id": 2, "body": {}}]})",
+        fields);
+    auto events = json.Get("events").value();
+    ASSERT_EQ(events.Size(), 2);
+    EXPECT_EQ(events.Get(0)->Size(), 1);
+    EXPECT_EQ(events.Get(1)->Get("id")->Get<double>(), 2);
+}
+
+TEST(JsonParserTest, ProjectionPaths) {
+    Projection all{""};
+    EXPECT_EQ(parseProjected(R"({"a": 1, "b": 2})", all).Size(), 2);
+    Projection nested{"/a/b", "/a"};
+    EXPECT_EQ(parseProjected(R"({"a": {"b": 1, "c": 2}})", nested)
+                  .Get("a")
+                  ->Size(),
+              2);
+    Projection escaped{"/a~1b"};
+    EXPECT_EQ(parseProjected(R"({"a/b": 1, "c": 2})", escaped).Size(), 1);
+    EXPECT_THROW(Projection{"a"}, std::runtime_error);
+    EXPECT_THROW(Projection{"/a~"}, std::runtime_error);
+}
+
+TEST(JsonParserTest, ProjectionReportsErrorsInSkippedFields) {
+    Projection fields{"/a"};
+    EXPECT_THROW(parseProjected(R"({"a": 1, "b": [1, 2)", fields),
+                 std::runtime_error);
+    EXPECT_THROW(parseProjected(R"({"a": 1, "b": 2 "c": 3})", fields),
+                 std::runtime_error);
+}
+
+/*
+ * Test packed arrays
+ */
+static const JsonArray &asArray(const Json &json) {
+    return static_cast<const JsonArray &>(*json.value);
+}
+
+static std::string dump(const Json &json) {
+    std::ostringstream out;
+    json.Dump(out);
+    return out.str();
+}
+
+TEST(JsonParserTest, PackedNumberArray) {
+    auto result = parseJSON(R"([1, 2.5, -3])");
+    EXPECT_EQ(asArray(result).Packing(), JsonArray::Storage::numbers);
+    auto numbers = asArray(result).Numbers();
+    EXPECT_EQ(std::vector<double>(numbers.begin(), numbers.end()),
+              (std::vector<double>{1, 2.5, -3}));
+    EXPECT_EQ(result.Size(), 3);
+    EXPECT_EQ(result.Get(1).value().Get<double>(), 2.5);
+    EXPECT_EQ(result.Get(3), std::nullopt);
+    EXPECT_EQ(dump(result), "[1, 2.5, -3]");
+}
+
+TEST(JsonParserTest, PackedBoolArray) {
+    auto result = parseJSON(R"({"flags": [true, false, true]})");
+    auto flags = result.Get("flags").value();
+    EXPECT_EQ(asArray(flags).Packing(), JsonArray::Storage::bools);
+    EXPECT_EQ(flags.Get(1).value().Get<bool>(), false);
+    EXPECT_EQ(dump(flags), "[true, false, true]");
+}
+
+TEST(JsonParserTest, MixedArraysAreGeneric) {
+    auto result = parseJSON(R"([1, 2, "x", 3])");
+    EXPECT_EQ(asArray(result).Packing(), JsonArray::Storage::generic);
+    EXPECT_EQ(result.Get(1).value().Get<double>(), 2);
+    EXPECT_EQ(result.Get(2).value().Get<std::string>(), "x");
+    EXPECT_EQ(dump(result), R"([1, 2, "x", 3])");
+    EXPECT_EQ(asArray(parseJSON("[true, 1]")).Packing(),
+              JsonArray::Storage::generic);
+    EXPECT_EQ(asArray(parseJSON("[]")).Packing(), JsonArray::Storage::generic);
+}
+
+TEST(JsonParserTest, PackedArrayMutation) {
+    auto result = parseJSON(R"([1, 2])");
+    result.AppendOrUpdate(0, 5.0);
+    result.AppendOrUpdate(Json::end, 6.0);
+    EXPECT_EQ(asArray(result).Packing(), JsonArray::Storage::numbers);
+    EXPECT_EQ(dump(result), "[5, 2, 6]");
+
+    result.AppendOrUpdate(1, "x");
+    EXPECT_EQ(asArray(result).Packing(), JsonArray::Storage::generic);
+    EXPECT_EQ(dump(result), R"([5, "x", 6])");
+
+    auto flags = parseJSON(R"([true])");
+    static_cast<JsonArray &>(*flags.value).Find(0);
+    EXPECT_EQ(asArray(flags).Packing(), JsonArray::Storage::generic);
+    EXPECT_EQ(flags.Get(0).value().Get<bool>(), true);
+}
+
+/*
+ * Test lazy numbers
+ */
+static Json parseLazy(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json, {.lazy_numbers = true});
+    return parser.Parse();
+}
+
+TEST(JsonParserTest, LazyNumbersEchoDigits) {
+    auto result =
+        parseLazy(R"({"a": 1.50, "b": [1e2, -0.0, 12345678901234567890]})");
+    EXPECT_EQ(dump(result.Get("a").value()), "1.50");
+    EXPECT_EQ(dump(result.Get("b").value()),
+              "[1e2, -0.0, 12345678901234567890]");
+    EXPECT_EQ(asArray(result.Get("b").value()).Packing(),
+              JsonArray::Storage::generic);
+}
+
+TEST(JsonParserTest, LazyNumbersConvertOnRead) {
+    auto result = parseLazy(R"([1.5, 9007199254740993, 1e3, 1e999, 2.5])");
+    EXPECT_EQ(result.Get(0).value().Get<double>(), 1.5);
+    EXPECT_EQ(result.Get(1).value().Get<int64_t>(), 9007199254740993);
+    EXPECT_EQ(result.Get(2).value().Get<int64_t>(), 1000);
+    EXPECT_EQ(result.Get(3).value().Get<double>(),
+              std::numeric_limits<double>::infinity());
+    EXPECT_EQ(result.Get(4).value().Get<int64_t>(), std::nullopt);
+}
+
+TEST(JsonParserTest, LazyNumbersAreValidated) {
+    for (auto json : {"[01]", "[1.]", "[.5]", "[+1]", "[1e]", "[-]", "[inf]",
+                      "[1x]"}) {
+        EXPECT_THROW(parseLazy(json), std::runtime_error) << json;
+    }
+}
+
+TEST(JsonParserTest, GetInt64) {
+    auto result = parseJSON(R"([3, 3.5, "3"])");
+    EXPECT_EQ(result.Get(0).value().Get<int64_t>(), 3);
+    EXPECT_EQ(result.Get(1).value().Get<int64_t>(), std::nullopt);
+    EXPECT_EQ(result.Get(2).value().Get<int64_t>(), std::nullopt);
+}
+
+/*
+ * Test parser reuse
+ */
+TEST(JsonParserTest, ResetParsesAnotherDocument) {
+    std::istringstream first(R"({"a": "some longer string value"})");
+    Parser parser(first);
+    EXPECT_EQ(parser.Parse().Get("a")->Get<std::string>(),
+              "some longer string value");
+
+    std::istringstream second(R"([1, 2])");
+    parser.Reset(second);
+    EXPECT_EQ(parser.Parse().Size(), 2);
+
+    // errors and positions do not leak into the next document
+    std::istringstream bad("\n\n[1,");
+    parser.Reset(bad);
+    auto error = parser.TryParse();
+    ASSERT_FALSE(error);
+    EXPECT_EQ(error.error().line, 3);
+
+    std::istringstream lazy("[1.50]");
+    parser.Reset(lazy, {.lazy_numbers = true});
+    EXPECT_EQ(dump(parser.Parse()), "[1.50]");
+}
+
+TEST(JsonParserTest, ParserPoolReusesParsers) {
+    Parser *first = nullptr;
+    {
+        std::istringstream json(R"({"a": 1})");
+        auto parser = ParserPool::Acquire(json);
+        first = &*parser;
+        EXPECT_EQ(parser->Parse().Get("a")->Get<double>(), 1);
+    }
+    {
+        std::istringstream json(R"([true])");
+        auto parser = ParserPool::Acquire(json);
+        EXPECT_EQ(&*parser, first);
+        std::istringstream nested(R"("x")");
+        auto other = ParserPool::Acquire(nested);
+        EXPECT_NE(&*other, first);
+        EXPECT_EQ(other->Parse().Get<std::string>(), "x");
+        EXPECT_EQ(parser->Parse().Get(0)->Get<bool>(), true);
+    }
+}
+
+TEST(JsonParserTest, StringTableSharesValues) {
+    StringTable table(2, 8);
+    ParserOptions options;
+    options.strings = &table;
+    std::istringstream first(R"([{"level": "INFO", "host": "a"},
+                                 {"level": "INFO", "host": "b"},
+                                 {"level": "a very long message"}])");
+    Parser parser(first, options);
+    Json json = parser.Parse();
+
+    auto level = [&json](size_t i, const char *key) {
+        return json.Get(i)->Get(key)->value;
+    };
+    EXPECT_EQ(level(0, "level"), level(1, "level"));
+    EXPECT_EQ(json.Get(1)->Get("host")->Get<std::string>(), "b");
+    // "b" came after the table was full, the long value is never interned
+    EXPECT_EQ(table.Size(), 2);
+
+    std::istringstream second(R"(["a", "b", "a very long message"])");
+    parser.Reset(second, options);
+    Json other = parser.Parse();
+    EXPECT_EQ(other.Get(0)->value, level(0, "host"));
+    EXPECT_NE(other.Get(1)->value, json.Get(1)->Get("host")->value);
+    EXPECT_NE(other.Get(2)->value, level(2, "level"));
+    EXPECT_EQ(dump(other), R"(["a", "b", "a very long message"])");
+}
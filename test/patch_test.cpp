@@ -0,0 +1,114 @@
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+static void expectJson(const Json &json, std::string expected) {
+    EXPECT_TRUE(json == parseJSON(expected)) << [&json] {
+        std::ostringstream out;
+        json.Dump(out);
+        return out.str();
+    }();
+}
+
+TEST(PatchTest, Operations) {
+    Json json = parseJSON(R"({"a": {"b": [1, 2, 3]}, "c": "x", "d~/": 1})");
+    json.ApplyPatch(parseJSON(R"([
+        {"op": "test", "path": "/a/b/1", "value": 2},
+        {"op": "add", "path": "/a/b/1", "value": 9},
+        {"op": "add", "path": "/a/b/-", "value": 4},
+        {"op": "remove", "path": "/a/b/0"},
+        {"op": "replace", "path": "/c", "value": {"y": null}},
+        {"op": "add", "path": "/e", "value": [true]},
+        {"op": "copy", "from": "/e", "path": "/c/z"},
+        {"op": "move", "from": "/d~0~1", "path": "/a/d"},
+        {"op": "replace", "path": "/a/b/0", "value": 8}
+    ])"));
+    expectJson(json, R"({"a": {"b": [8, 2, 3, 4], "d": 1},
+                         "c": {"y": null, "z": [true]}, "e": [true]})");
+
+    // copies are independent of their source
+    json.ApplyPatch(
+        parseJSON(R"([{"op": "add", "path": "/c/z/0", "value": 0}])"));
+    expectJson(*json.Get("e"), "[true]");
+
+    json.ApplyPatch(
+        parseJSON(R"([{"op": "replace", "path": "", "value": 5}])"));
+    expectJson(json, "5");
+}
+
+TEST(PatchTest, FailureRollsBack) {
+    std::string original = R"({"a": [1, 2, 3], "b": {"c": "x"}, "n": 1})";
+    Json json = parseJSON(original);
+    Json alias = json;
+    for (auto patch : {
+             R"([{"op": "remove", "path": "/a/0"},
+                 {"op": "add", "path": "/b/c", "value": 2},
+                 {"op": "move", "from": "/b", "path": "/a/-"},
+                 {"op": "replace", "path": "/n", "value": 2},
+                 {"op": "test", "path": "/n", "value": 1}])",
+             R"([{"op": "add", "path": "/z", "value": 1},
+                 {"op": "replace", "path": "", "value": []},
+                 {"op": "remove", "path": "/missing"}])",
+             R"([{"op": "remove", "path": "/a/1"},
+                 {"op": "add", "path": "/a/5", "value": 1}])",
+             R"([{"op": "move", "from": "/b", "path": "/b/c/d"}])",
+             R"([{"op": "add", "path": "/a/01", "value": 1}])",
+             R"([{"op": "frobnicate", "path": "/a"}])",
+             R"([{"op": "add", "value": 1}])"}) {
+        EXPECT_THROW(json.ApplyPatch(parseJSON(patch)), std::runtime_error)
+            << patch;
+        expectJson(json, original);
+        EXPECT_EQ(json.value, alias.value);
+    }
+}
+
+TEST(PatchTest, PackedArrays) {
+    Json json = parseJSON("[1, 2, 3]");
+    json.ApplyPatch(parseJSON(R"([{"op": "remove", "path": "/1"},
+                                  {"op": "add", "path": "/0", "value": 0},
+                                  {"op": "replace", "path": "/2",
+                                   "value": 5}])"));
+    auto &array = static_cast<const JsonArray &>(*json.value);
+    EXPECT_EQ(array.Packing(), JsonArray::Storage::numbers);
+    expectJson(json, "[0, 1, 5]");
+
+    EXPECT_THROW(json.ApplyPatch(parseJSON(
+                     R"([{"op": "add", "path": "/0", "value": "s"},
+                         {"op": "remove", "path": "/9"}])")),
+                 std::runtime_error);
+    expectJson(json, "[0, 1, 5]");
+}
+
+TEST(PatchTest, MergePatch) {
+    Json json = parseJSON(R"({"a": "b", "c": {"d": "e", "f": "g"}, "h": [1]})");
+    json.ApplyMergePatch(parseJSON(
+        R"({"a": "z", "c": {"f": null, "i": {"j": null, "k": 1}}, "h": 2})"));
+    expectJson(json, R"({"a": "z", "c": {"d": "e", "i": {"k": 1}}, "h": 2})");
+
+    json.ApplyMergePatch(parseJSON(R"(["replaced"])"));
+    expectJson(json, R"(["replaced"])");
+    json.ApplyMergePatch(parseJSON(R"({"a": 1})"));
+    expectJson(json, R"({"a": 1})");
+}
+
+TEST(PatchTest, ArrayAndObjectErase) {
+    Json json = parseJSON(R"([true, "s", null])");
+    auto &array = static_cast<JsonArray &>(*json.value);
+    expectJson(array.Erase(1), R"("s")");
+    array.Insert(0, *parseJSON("[7]").Get(0));
+    expectJson(json, "[7, true, null]");
+
+    Json object = parseJSON(R"({"a": 1})");
+    auto &items = static_cast<JsonObject &>(*object.value);
+    EXPECT_FALSE(items.Erase("b"));
+    expectJson(*items.Erase("a"), "1");
+    EXPECT_EQ(object.Size(), 0);
+}
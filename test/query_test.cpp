@@ -0,0 +1,116 @@
+#include "json.hpp"
+#include "parser.hpp"
+#include "query.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+static const char *doc = R"({
+    "users": [
+        {"name": "ada", "tags": ["a", "b"]},
+        {"name": "bob", "tags": []},
+        {"name": "cy", "tags": ["c"]}
+    ],
+    "a/b": 1,
+    "m~n": 2,
+    "a b": 3,
+    "config": {"x": true}
+})";
+
+static std::string dump(const Json &json) {
+    std::ostringstream out;
+    json.Dump(out);
+    return out.str();
+}
+
+static std::vector<std::string> names(const std::vector<Json> &matches) {
+    std::vector<std::string> out;
+    for (auto &match : matches) {
+        out.push_back(match.Get<std::string>().value());
+    }
+    return out;
+}
+
+TEST(QueryTest, JsonPointer) {
+    Json json = parseJSON(doc);
+    EXPECT_EQ(Query::Compile("").Select(json).size(), 1);
+    EXPECT_EQ(Query::Compile("/users/1/name")
+                  .SelectFirst(json)
+                  .value()
+                  .Get<std::string>(),
+              "bob");
+    EXPECT_EQ(Query::Compile("/a~1b").SelectFirst(json)->Get<double>(), 1);
+    EXPECT_EQ(Query::Compile("/m~0n").SelectFirst(json)->Get<double>(), 2);
+    EXPECT_EQ(Query::Compile("/users/3").SelectFirst(json), std::nullopt);
+    EXPECT_EQ(Query::Compile("/users/01").SelectFirst(json), std::nullopt);
+    EXPECT_THROW(Query::Compile("users"), std::runtime_error);
+    EXPECT_THROW(Query::Compile("/a~2"), std::runtime_error);
+}
+
+TEST(QueryTest, JsonPath) {
+    Json json = parseJSON(doc);
+    EXPECT_EQ(names(Query::Compile("$.users[*].name").Select(json)),
+              (std::vector<std::string>{"ada", "bob", "cy"}));
+    EXPECT_EQ(names(Query::Compile("$.users[-1].name").Select(json)),
+              (std::vector<std::string>{"cy"}));
+    EXPECT_EQ(names(Query::Compile("$.users[1:].name").Select(json)),
+              (std::vector<std::string>{"bob", "cy"}));
+    EXPECT_EQ(names(Query::Compile("$.users[:-1].tags[0]").Select(json)),
+              (std::vector<std::string>{"a"}));
+    EXPECT_EQ(Query::Compile("$['a b']").SelectFirst(json)->Get<double>(), 3);
+    EXPECT_EQ(Query::Compile("$.config.*").Select(json).size(), 1);
+    EXPECT_EQ(Query::Compile("$.users.name").Select(json).size(), 0);
+    EXPECT_THROW(Query::Compile("$..name"), std::runtime_error);
+    EXPECT_THROW(Query::Compile("$.users[x]"), std::runtime_error);
+    EXPECT_THROW(Query::Compile("$.users[0"), std::runtime_error);
+}
+
+TEST(QueryTest, MatchesAliasTheDocument) {
+    Json json = parseJSON(doc);
+    auto match = Query::Compile("$.config").SelectFirst(json).value();
+    match.InsertOrUpdate("y", 1.0);
+    EXPECT_EQ(json.Get("config")->Size(), 2);
+}
+
+TEST(QueryTest, StreamMatchesDom) {
+    Json json = parseJSON(doc);
+    for (auto expr : {"", "/users/2/tags", "/a~1b", "$.users[*].name",
+                      "$.users[-2:].tags[*]", "$.users[0:2].name",
+                      "$['a b']", "$.config.*", "$.missing[0]"}) {
+        auto query = Query::Compile(expr);
+        std::istringstream stream(doc);
+        auto streamed = query.Select(stream);
+        auto expected = query.Select(json);
+        ASSERT_EQ(streamed.size(), expected.size()) << expr;
+        for (size_t i = 0; i < streamed.size(); ++i) {
+            EXPECT_EQ(dump(streamed[i]), dump(expected[i])) << expr;
+        }
+    }
+}
+
+TEST(QueryTest, StreamStopsAtFirstMatch) {
+    // the trailing garbage is never read
+    std::istringstream stream(R"({"a": [1, {"b": 2}], "c": )");
+    auto first = Query::Compile("$.a[*]").SelectFirst(stream);
+    EXPECT_EQ(first->Get<double>(), 1);
+
+    std::istringstream complete(R"({"a": [1, {"b": 2}], "c": )");
+    EXPECT_THROW(Query::Compile("$.a[*]").Select(complete),
+                 std::runtime_error);
+}
+
+TEST(QueryTest, StreamSkipsMalformedInputOutsideMatches) {
+    std::istringstream missing(R"({"a": 1 "b": 2})");
+    EXPECT_THROW(Query::Compile("/b").Select(missing), std::runtime_error);
+    std::istringstream trailing(R"([1, 2] 3)");
+    EXPECT_THROW(Query::Compile("/0").Select(trailing), std::runtime_error);
+    std::istringstream empty("");
+    EXPECT_THROW(Query::Compile("/0").Select(empty), std::runtime_error);
+}
@@ -0,0 +1,133 @@
+#include "parser.hpp"
+#include "schema.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+static Expected<Json> check(const Schema &schema, std::string json_str,
+                            ParserOptions options = {}) {
+    options.schema = &schema;
+    std::istringstream json(json_str);
+    Parser parser(json, options);
+    return parser.TryParse();
+}
+
+static const Schema user = Schema::Compile(parseJSON(R"({
+    "type": "object",
+    "required": ["id", "name"],
+    "properties": {
+        "id": {"type": "integer", "minimum": 1},
+        "name": {"type": "string", "minLength": 1, "maxLength": 4},
+        "level": {"enum": ["INFO", "WARN", null]},
+        "scores": {"type": "array", "maxItems": 3,
+                   "items": {"type": "number", "exclusiveMaximum": 100}},
+        "tags": {"type": "array", "minItems": 1,
+                 "items": {"type": "string"}}
+    },
+    "additionalProperties": false
+})"));
+
+TEST(SchemaTest, Accepts) {
+    for (auto json : {R"({"id": 1, "name": "ab"})",
+                      R"({"name": "éééé", "id": 7.0})",
+                      R"({"id": 2, "name": "x", "level": null})",
+                      R"({"id": 2, "name": "x", "level": "WARN",
+                          "scores": [1, 99.5], "tags": ["a", "b"]})"}) {
+        auto result = check(user, json);
+        EXPECT_TRUE(result) << json;
+    }
+    auto result = check(user, R"({"id": 3, "name": "abc"})");
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->Get("name")->Get<std::string>(), "abc");
+}
+
+TEST(SchemaTest, Rejects) {
+    for (auto json : {R"([])", R"({"id": 1})", R"({"id": 0, "name": "a"})",
+                      R"({"id": 1.5, "name": "a"})",
+                      R"({"id": "1", "name": "a"})",
+                      R"({"id": 1, "name": ""})",
+                      R"({"id": 1, "name": "abcde"})",
+                      R"({"id": 1, "name": "a", "level": "DEBUG"})",
+                      R"({"id": 1, "name": "a", "extra": 1})",
+                      R"({"id": 1, "name": "a", "scores": [1, 100]})",
+                      R"({"id": 1, "name": "a", "scores": [1, 2, 3, 4]})",
+                      R"({"id": 1, "name": "a", "scores": [1, true]})",
+                      R"({"id": 1, "name": "a", "tags": []})",
+                      R"({"id": 1, "name": "a", "tags": [1]})"}) {
+        auto result = check(user, json);
+        ASSERT_FALSE(result) << json;
+        EXPECT_EQ(result.error().code, ParseErrorCode::schema_violation)
+            << json;
+    }
+    // syntax errors are still reported as such
+    auto result = check(user, R"({"id": 1,)");
+    ASSERT_FALSE(result);
+    EXPECT_NE(result.error().code, ParseErrorCode::schema_violation);
+}
+
+TEST(SchemaTest, StopsAtFirstViolation) {
+    // the rest of the input is never read, so it need not even be json
+    auto result = check(user, R"({"id": 1, "name": "a", "extra": ][)");
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, ParseErrorCode::schema_violation);
+    EXPECT_EQ(result.error().column, 24);
+    EXPECT_STREQ(result.error().message, "Key is not allowed by the schema");
+
+    auto scores = check(user, R"({"id": 1, "scores": [1, 2, 300, ]][)");
+    ASSERT_FALSE(scores);
+    EXPECT_EQ(scores.error().code, ParseErrorCode::schema_violation);
+    EXPECT_EQ(scores.error().column, 28);
+}
+
+TEST(SchemaTest, Projection) {
+    Projection fields{"/name"};
+    ParserOptions options;
+    options.projection = &fields;
+    // skipped values are not checked, required keys still are
+    EXPECT_TRUE(check(user, R"({"id": "skipped", "name": "a"})", options));
+    EXPECT_FALSE(check(user, R"({"name": "a"})", options));
+    EXPECT_FALSE(check(user, R"({"id": 1, "name": 5})", options));
+    // a repeated required key is not counted twice
+    EXPECT_FALSE(check(user, R"({"id": "a", "id": "b"})", options));
+}
+
+TEST(SchemaTest, RequiredOutsideProperties) {
+    Schema typed = Schema::Compile(parseJSON(R"({
+        "required": ["id"], "additionalProperties": {"type": "string"}
+    })"));
+    EXPECT_TRUE(check(typed, R"({"id": "5"})"));
+    EXPECT_FALSE(check(typed, R"({"id": 5})"));
+    EXPECT_FALSE(check(typed, "{}"));
+
+    Schema closed = Schema::Compile(parseJSON(R"({
+        "required": ["id"], "additionalProperties": false
+    })"));
+    EXPECT_FALSE(check(closed, R"({"id": 5})"));
+}
+
+TEST(SchemaTest, Subschemas) {
+    Schema schema = Schema::Compile(parseJSON(R"({
+        "type": ["array", "null"],
+        "items": {"additionalProperties": {"type": "boolean"},
+                  "properties": {"n": {"const": 1}}}
+    })"));
+    EXPECT_TRUE(check(schema, "null"));
+    EXPECT_TRUE(check(schema, R"([{"n": 1, "a": true}, {}])"));
+    EXPECT_FALSE(check(schema, R"([{"n": 2}])"));
+    EXPECT_FALSE(check(schema, R"([{"a": 1}])"));
+    EXPECT_FALSE(check(schema, "1"));
+
+    EXPECT_TRUE(check(Schema::Compile(parseJSON("true")), "[1]"));
+    EXPECT_FALSE(check(Schema::Compile(parseJSON("false")), "[1]"));
+    EXPECT_THROW(Schema::Compile(parseJSON(R"({"type": "float"})")),
+                 std::runtime_error);
+    EXPECT_THROW(Schema::Compile(parseJSON(R"({"minLength": -1})")),
+                 std::runtime_error);
+}
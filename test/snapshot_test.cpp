@@ -0,0 +1,143 @@
+#include "json.hpp"
+#include "parser.hpp"
+#include "snapshot.hpp"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+static std::string dump(const Json &json) {
+    std::ostringstream out;
+    json.Dump(out);
+    return out.str();
+}
+
+TEST(SnapshotTest, Scalars) {
+    for (auto str : {"null", "true", "false", "4.25", R"("text")"}) {
+        auto bytes = Snapshot::Write(parseJSON(str));
+        EXPECT_EQ(dump(Snapshot::Load(bytes).Root().ToJson()), str);
+    }
+}
+
+TEST(SnapshotTest, NestedAccess) {
+    auto bytes = Snapshot::Write(parseJSON(R"({
+        "users": [
+            {"id": 1, "name": "Alice", "active": true},
+            {"id": 2, "name": "Bob", "active": false}
+        ],
+        "metadata": {"version": "1.0", "tags": []}
+    })"));
+    auto snapshot = Snapshot::Load(bytes);
+    auto root = snapshot.Root();
+    EXPECT_EQ(root.Type(), JsonType::jobject);
+    EXPECT_EQ(root.Size(), 2);
+    auto users = root.Get("users").value();
+    EXPECT_EQ(users.Type(), JsonType::jarray);
+    EXPECT_EQ(users.Size(), 2);
+    EXPECT_EQ(users.Get(0).value().Get("name").value().Get<std::string>(),
+              "Alice");
+    EXPECT_EQ(users.Get(1).value().Get("id").value().Get<double>(), 2);
+    EXPECT_EQ(users.Get(1).value().Get("active").value().Get<bool>(), false);
+    EXPECT_EQ(users.Get(2), std::nullopt);
+    EXPECT_EQ(root.Get("metadata").value().Get("tags").value().Size(), 0);
+    EXPECT_EQ(root.Get("missing"), std::nullopt);
+    EXPECT_EQ(root.Get(0), std::nullopt);
+    EXPECT_EQ(root.Get("metadata").value().Get<double>(), std::nullopt);
+}
+
+TEST(SnapshotTest, InsertedValuesKeepTheirType) {
+    auto json = parseJSON("{}");
+    json.InsertOrUpdate("flag", true);
+    json.InsertOrUpdate("count", 3);
+    json.InsertOrUpdate("name", "x");
+    auto bytes = Snapshot::Write(json);
+    auto root = Snapshot::Load(bytes).Root();
+    EXPECT_EQ(root.Get("flag").value().Get<bool>(), true);
+    EXPECT_EQ(root.Get("count").value().Get<double>(), 3);
+    EXPECT_EQ(root.Get("name").value().Get<std::string_view>(), "x");
+}
+
+TEST(SnapshotTest, RoundTrip) {
+    auto json = parseJSON(R"([1, [2, [3, {"a": [null, "b"]}]], {}])");
+    auto bytes = Snapshot::Write(json);
+    EXPECT_EQ(dump(Snapshot::Load(bytes).Root().ToJson()), dump(json));
+}
+
+TEST(SnapshotTest, SaveAndMap) {
+    std::string path = testing::TempDir() + "sjp_snapshot_test.bin";
+    std::string data(R"({"data": [)");
+    for (int i = 0; i < 1000; ++i) {
+        data += std::to_string(i) + ",";
+    }
+    data.back() = ']';
+    data += "}";
+    Snapshot::Save(parseJSON(data), path);
+    {
+        auto snapshot = Snapshot::Map(path);
+        auto arr = snapshot.Root().Get("data").value();
+        EXPECT_EQ(arr.Size(), 1000);
+        EXPECT_EQ(arr.Get(999).value().Get<double>(), 999);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotTest, InvalidSnapshot) {
+    auto bytes = Snapshot::Write(parseJSON(R"({"a": [1, 2]})"));
+    EXPECT_THROW(Snapshot::Load(bytes.substr(0, bytes.size() - 1)),
+                 std::runtime_error);
+    EXPECT_THROW(Snapshot::Load("JSON"), std::runtime_error);
+    std::string swapped = bytes;
+    std::swap(swapped[6], swapped[7]);
+    EXPECT_THROW(Snapshot::Load(swapped), std::runtime_error);
+}
+
+TEST(SnapshotTest, FreezeOutlivesTheTree) {
+    Snapshot frozen = [] {
+        Json json = parseJSON(R"({"limits": {"cpu": 4, "mem": [1, 2.5]},
+                                  "name": "svc"})");
+        return Snapshot::Freeze(json);
+    }();
+    auto root = frozen.Root();
+    EXPECT_EQ(root.Get("limits")->Get("cpu")->Get<int64_t>(), 4);
+    EXPECT_EQ(root.Get("limits")->Get("mem")->Get(1)->Get<double>(), 2.5);
+    EXPECT_EQ(root.Get("limits")->Get("mem")->Get(1)->Get<int64_t>(),
+              std::nullopt);
+    EXPECT_EQ(root.Get("name")->Get<std::string_view>(), "svc");
+}
+
+TEST(SnapshotTest, FrozenConcurrentReaders) {
+    std::string json = "{";
+    for (int i = 0; i < 100; ++i) {
+        json += (i ? ", \"k" : "\"k") + std::to_string(i) +
+                "\": " + std::to_string(i);
+    }
+    json += "}";
+    Snapshot frozen = Snapshot::Freeze(parseJSON(json));
+
+    std::vector<std::thread> readers;
+    std::vector<double> sums(8);
+    for (size_t t = 0; t < sums.size(); ++t) {
+        readers.emplace_back([&frozen, &sum = sums[t]] {
+            auto root = frozen.Root();
+            for (int round = 0; round < 100; ++round) {
+                for (int i = 0; i < 100; ++i) {
+                    sum += *root.Get("k" + std::to_string(i))->Get<double>();
+                }
+            }
+        });
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    for (double sum : sums) {
+        EXPECT_EQ(sum, 100 * 4950);
+    }
+}
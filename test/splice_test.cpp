@@ -0,0 +1,76 @@
+#include "builder.hpp"
+#include "splice.hpp"
+#include <gtest/gtest.h>
+
+using namespace sjp;
+
+TEST(SpliceTest, Replace) {
+    std::string json = R"({ "a": {"b": [1, 22, 3]},  "c" : "x" })";
+    EXPECT_EQ(Splice(json, "/a/b/1", ToJson(7)),
+              R"({ "a": {"b": [1, 7, 3]},  "c" : "x" })");
+    EXPECT_EQ(Splice(json, "/c", MakeArray(true, "y")),
+              R"({ "a": {"b": [1, 22, 3]},  "c" : [true,"y"] })");
+    EXPECT_EQ(Splice(json, "/a", ToJson(JNull{})),
+              R"({ "a": null,  "c" : "x" })");
+    EXPECT_EQ(Splice(json, "", ToJson(1)), "1");
+}
+
+TEST(SpliceTest, Insert) {
+    EXPECT_EQ(Splice(R"({"a": 1})", "/b", ToJson(2)), R"({"a": 1,"b":2})");
+    EXPECT_EQ(Splice("{ }", "/a~1b", ToJson(2)), R"({ "a/b":2})");
+    EXPECT_EQ(Splice("[1, 2]", "/-", ToJson(3)), "[1, 2,3]");
+    EXPECT_EQ(Splice("[]", "/-", ToJson(3)), "[3]");
+}
+
+TEST(SpliceTest, Remove) {
+    std::string json = R"({"a": 1, "b": [2, 3], "c": 4})";
+    EXPECT_EQ(SpliceRemove(json, "/a"), R"({"b": [2, 3], "c": 4})");
+    EXPECT_EQ(SpliceRemove(json, "/b"), R"({"a": 1, "c": 4})");
+    EXPECT_EQ(SpliceRemove(json, "/c"), R"({"a": 1, "b": [2, 3]})");
+    EXPECT_EQ(SpliceRemove(json, "/b/1"), R"({"a": 1, "b": [2], "c": 4})");
+    EXPECT_EQ(SpliceRemove("[1]", "/0"), "[]");
+}
+
+TEST(SpliceTest, Locate) {
+    std::string json = R"({"s": "a}\"]", "n": [{"x": -1.5e3}]})";
+    auto span = Locate(json, "/n/0/x");
+    ASSERT_TRUE(span);
+    EXPECT_EQ(json.substr(span->begin, span->end - span->begin), "-1.5e3");
+    span = Locate(json, "/s");
+    ASSERT_TRUE(span);
+    EXPECT_EQ(json.substr(span->begin, span->end - span->begin),
+              R"("a}\"]")");
+    EXPECT_FALSE(Locate(json, "/n/1"));
+    EXPECT_FALSE(Locate(json, "/n/01"));
+    EXPECT_FALSE(Locate(json, "/s/x"));
+}
+
+TEST(SpliceTest, Comments) {
+    std::string json = R"({"a": 1, /* } */ "b": 2})";
+    auto span = Locate(json, "/b");
+    ASSERT_TRUE(span);
+    EXPECT_EQ(json.substr(span->begin, span->end - span->begin), "2");
+    json = "{\"a\": [1, // ]\n 2], \"b\": 2}";
+    span = Locate(json, "/b");
+    ASSERT_TRUE(span);
+    EXPECT_EQ(json.substr(span->begin, span->end - span->begin), "2");
+    span = Locate(json, "/a/1");
+    ASSERT_TRUE(span);
+    EXPECT_EQ(json.substr(span->begin, span->end - span->begin), "2");
+
+    EXPECT_EQ(Splice("// header\n{\"b\": 2}", "/b", ToJson(3)),
+              "// header\n{\"b\": 3}");
+    EXPECT_EQ(Splice("[1/* one */, 2]", "/0", ToJson(5)), "[5/* one */, 2]");
+    EXPECT_EQ(SpliceRemove(R"({"a": 1, /* b */ "b": 2})", "/b"),
+              R"({"a": 1})");
+    EXPECT_THROW(Locate("[1, /* open", "/1"), std::runtime_error);
+}
+
+TEST(SpliceTest, Errors) {
+    EXPECT_THROW(Splice(R"({"a": 1})", "/b/c", ToJson(1)),
+                 std::runtime_error);
+    EXPECT_THROW(Splice("[1]", "/5", ToJson(1)), std::runtime_error);
+    EXPECT_THROW(SpliceRemove(R"({"a": 1})", "/b"), std::runtime_error);
+    EXPECT_THROW(SpliceRemove(R"({"a": 1})", ""), std::runtime_error);
+    EXPECT_THROW(Locate(R"({"a": 1)", "/b"), std::runtime_error);
+}
@@ -0,0 +1,77 @@
+#include "validate.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace sjp;
+
+static ValidationStatus status(std::string_view json) {
+    return Validate(json).status;
+}
+
+TEST(ValidateTest, ValidDocuments) {
+    for (std::string_view json :
+         {R"({"key": "value"})", "[]", "{}", " \t\r\n[1, 2.5, -0.5e10]\n",
+          "null", "true", "false", "0", "-0", "1E+2", R"("é\n\/")",
+          R"({"a": {"b": [{"c": [[], {}]}]}, "d": null})",
+          R"(["汉字", "😊", "مرحبا", "ascii only string longer than 16"])"}) {
+        EXPECT_TRUE(Validate(json)) << json;
+    }
+}
+
+TEST(ValidateTest, ReportsOffset) {
+    auto result = Validate(R"({"key": "value",})");
+    EXPECT_EQ(result.status, ValidationStatus::unexpected_character);
+    EXPECT_EQ(result.offset, 16);
+    EXPECT_EQ(Validate("[1, 2]").offset, 6);
+}
+
+TEST(ValidateTest, InvalidGrammar) {
+    EXPECT_EQ(status(""), ValidationStatus::unexpected_end);
+    EXPECT_EQ(status("   "), ValidationStatus::unexpected_end);
+    EXPECT_EQ(status(R"({"key": "value")"), ValidationStatus::unexpected_end);
+    EXPECT_EQ(status(R"({key: 1})"), ValidationStatus::unexpected_character);
+    EXPECT_EQ(status(R"({"a" 1})"), ValidationStatus::unexpected_character);
+    EXPECT_EQ(status("[1,]"), ValidationStatus::unexpected_character);
+    EXPECT_EQ(status("[1 2]"), ValidationStatus::unexpected_character);
+    EXPECT_EQ(status("[1}"), ValidationStatus::unexpected_character);
+    EXPECT_EQ(status("{} {}"), ValidationStatus::trailing_characters);
+    EXPECT_EQ(status("[1] // comment"), ValidationStatus::trailing_characters);
+    EXPECT_EQ(status("nul"), ValidationStatus::invalid_literal);
+    EXPECT_EQ(status("[tru]"), ValidationStatus::invalid_literal);
+}
+
+TEST(ValidateTest, InvalidNumbers) {
+    for (std::string_view json : {"01", "-", "1.", ".5", "1e", "+1", "0x10"}) {
+        EXPECT_FALSE(Validate(json)) << json;
+    }
+    EXPECT_EQ(status("-a"), ValidationStatus::invalid_number);
+    EXPECT_EQ(status("[1.e5]"), ValidationStatus::invalid_number);
+}
+
+TEST(ValidateTest, InvalidStrings) {
+    EXPECT_EQ(status(R"("abc)"), ValidationStatus::unexpected_end);
+    EXPECT_EQ(status(R"("a\x")"), ValidationStatus::invalid_escape);
+    EXPECT_EQ(status(R"("\u12G4")"), ValidationStatus::invalid_escape);
+    EXPECT_EQ(status("\"a\tb\""), ValidationStatus::control_character);
+    auto result = Validate("\"0123456789abcdef0123\n\"");
+    EXPECT_EQ(result.status, ValidationStatus::control_character);
+    EXPECT_EQ(result.offset, 21);
+}
+
+TEST(ValidateTest, InvalidUtf8) {
+    for (std::string_view json :
+         {"\"\x80\"", "\"\xC0\xAF\"", "\"\xE0\x80\xAF\"", "\"\xED\xA0\x80\"",
+          "\"\xF4\x90\x80\x80\"", "\"\xF8\x88\x80\x80\x80\"", "\"\xC3\"",
+          "\"0123456789abcdef\xFF\""}) {
+        EXPECT_EQ(status(json), ValidationStatus::invalid_utf8) << json;
+    }
+    EXPECT_EQ(Validate("\"0123456789abcdef\xFF\"").offset, 17);
+}
+
+TEST(ValidateTest, NestingLimit) {
+    std::string deep(max_validation_depth, '[');
+    deep += std::string(max_validation_depth, ']');
+    EXPECT_TRUE(Validate(deep));
+    deep = "[" + deep + "]";
+    EXPECT_EQ(status(deep), ValidationStatus::nesting_too_deep);
+}
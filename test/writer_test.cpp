@@ -0,0 +1,123 @@
+#include "parser.hpp"
+#include "writer.hpp"
+#include <csignal>
+#include <gtest/gtest.h>
+#include <limits>
+#include <sstream>
+#include <unistd.h>
+
+using namespace sjp;
+
+static Json parseJSON(std::string json_str) {
+    std::istringstream json(json_str);
+    Parser parser(json);
+    return parser.Parse();
+}
+
+TEST(WriterTest, Compact) {
+    std::string out;
+    JsonWriter writer(out);
+    writer.StartObject()
+        .Key("ids")
+        .StartArray()
+        .Value(1)
+        .Value(2.5)
+        .Value(uint64_t{18446744073709551615u})
+        .EndArray()
+        .Key("name")
+        .Value("a\"b\n")
+        .Key("ok")
+        .Value(true)
+        .Key("none")
+        .Null()
+        .Key("empty")
+        .StartObject()
+        .EndObject()
+        .EndObject();
+    EXPECT_EQ(out, R"({"ids":[1,2.5,18446744073709551615],"name":"a\"b\n",)"
+                   R"("ok":true,"none":null,"empty":{}})");
+}
+
+TEST(WriterTest, Pretty) {
+    std::string out;
+    JsonWriter writer(out, JsonWriter::Style::pretty);
+    writer.StartObject()
+        .Key("a")
+        .StartArray()
+        .Value(1)
+        .StartArray()
+        .EndArray()
+        .EndArray()
+        .Key("b")
+        .Value("x")
+        .EndObject();
+    EXPECT_EQ(out, "{\n    \"a\": [\n        1,\n        []\n    ],\n"
+                   "    \"b\": \"x\"\n}");
+}
+
+TEST(WriterTest, Numbers) {
+    std::string out;
+    JsonWriter writer(out);
+    writer.StartArray()
+        .Value(0.1)
+        .Value(1e300)
+        .Value(-0.0)
+        .Value(std::numeric_limits<double>::infinity())
+        .Value(-42)
+        .EndArray();
+    EXPECT_EQ(out, "[0.1,1e+300,-0,null,-42]");
+}
+
+TEST(WriterTest, WritesTrees) {
+    Json json = parseJSON(R"({"a": [1, 2], "b": [true], "c": "x\"y",
+                              "d": [null, {"e": 0.5}]})");
+    std::string out;
+    JsonWriter(out).Value(json);
+    EXPECT_EQ(out.size(), std::string(R"({"a":[1,2],"b":[true],"c":"x\"y",)"
+                                      R"("d":[null,{"e":0.5}]})")
+                              .size());
+    std::string again;
+    JsonWriter(again).Value(parseJSON(out));
+    EXPECT_EQ(parseJSON(again).Get("c")->Get<std::string>(), R"(x\"y)");
+    EXPECT_EQ(parseJSON(again).Get("d")->Get(1)->Get("e")->Get<double>(), 0.5);
+
+    std::istringstream lazy("[1.50, 1e2]");
+    Parser parser(lazy, {.lazy_numbers = true});
+    std::string digits;
+    JsonWriter(digits).Value(parser.Parse());
+    EXPECT_EQ(digits, "[1.50,1e2]");
+}
+
+TEST(WriterTest, FdSink) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    {
+        JsonWriter writer(fds[1], JsonWriter::Style::compact, 8);
+        writer.StartArray();
+        for (int i = 0; i < 100; ++i) {
+            writer.Value(i);
+        }
+        writer.EndArray();
+    }
+    close(fds[1]);
+    std::string read_back;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+        read_back.append(buf, static_cast<size_t>(n));
+    }
+    close(fds[0]);
+    EXPECT_EQ(parseJSON(read_back).Size(), 100);
+    EXPECT_EQ(read_back.substr(0, 7), "[0,1,2,");
+}
+
+TEST(WriterTest, FlushReportsErrors) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    close(fds[0]);
+    JsonWriter broken(fds[1], JsonWriter::Style::compact, 1024);
+    broken.Value("x");
+    signal(SIGPIPE, SIG_IGN);
+    EXPECT_THROW(broken.Flush(), std::runtime_error);
+    close(fds[1]);
+}